@@ -0,0 +1,502 @@
+#include "perlin/fixed_perlin_noise_generator.h"
+#include "perlin/fractal_noise_generator.h"
+#include "perlin/generator_traits.h"
+#include "perlin/noise_expression.h"
+#include "perlin/perlin_noise_generator.h"
+#include "perlin/point.h"
+#include "perlin/seamless_noise_generator_2d.h"
+#include "perlin/simplex_noise_generator.h"
+#include "perlin/vector.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Benchmarks all generator configurations and prints one record per configuration, either as CSV
+ * (default) or as JSON lines (--json). Every configuration is repeated until it ran for at least
+ * --min-time-ms milliseconds (default 20).
+ *
+ * Modes:
+ *  - at:        at() on random points
+ *  - batch:     multi-point at() on the same random points
+ *  - packed:    at_packed() on the same random points, evaluating all octaves of a point at once
+ *  - grid:      fill_grid() on a regular grid of about as many points
+ *  - volume:    fill_volume() on a 32^3 voxel volume (3D generators only)
+ *  - construct: construction from a seeded engine, reported per generator instead of per sample
+ *
+ * Generators live on the heap, as the tables of large configurations can exceed the stack.
+ */
+
+using namespace noise;
+
+namespace
+{
+constexpr std::size_t const samplesPerRun = 4096;
+
+struct config
+{
+    bool json = false;
+    double minTimeMs = 20;
+};
+
+struct record
+{
+    std::string generator;
+    std::string mode;
+    std::string type;
+    int dim = 0;
+    int smoothness = -1;   // -1 if not applicable
+    int numGradients = -1; // -1 if not applicable
+    int octaves = -1;      // -1 if not applicable
+};
+
+class reporter
+{
+  public:
+    explicit reporter(config const& cfg)
+        : m_cfg(cfg)
+    {
+        if (!m_cfg.json)
+        {
+            std::cout << "generator,mode,type,dim,smoothness,num_gradients,octaves,ns_per_sample,"
+                         "samples_per_sec"
+                      << std::endl;
+        }
+    }
+
+    void report(record const& r, double nsPerSample) const
+    {
+        auto optional = [](int v) { return v < 0 ? std::string{} : std::to_string(v); };
+        auto optionalJson = [](int v) { return v < 0 ? std::string{"null"} : std::to_string(v); };
+        double samplesPerSec = 1e9 / nsPerSample;
+        if (m_cfg.json)
+        {
+            std::cout << R"({"generator":")" << r.generator << R"(","mode":")" << r.mode
+                      << R"(","type":")" << r.type << R"(","dim":)" << r.dim
+                      << R"(,"smoothness":)" << optionalJson(r.smoothness)
+                      << R"(,"num_gradients":)" << optionalJson(r.numGradients)
+                      << R"(,"octaves":)" << optionalJson(r.octaves) << R"(,"ns_per_sample":)"
+                      << nsPerSample << R"(,"samples_per_sec":)" << samplesPerSec << "}"
+                      << std::endl;
+        }
+        else
+        {
+            std::cout << r.generator << "," << r.mode << "," << r.type << "," << r.dim << ","
+                      << optional(r.smoothness) << "," << optional(r.numGradients) << ","
+                      << optional(r.octaves) << "," << nsPerSample << "," << samplesPerSec
+                      << std::endl;
+        }
+    }
+
+    double min_time_ms() const noexcept { return m_cfg.minTimeMs; }
+
+  private:
+    config m_cfg;
+};
+
+template<typename T>
+std::string type_name()
+{
+    if constexpr (std::is_same_v<T, float>)
+        return "float";
+    else if constexpr (std::is_same_v<T, double>)
+        return "double";
+    else if constexpr (std::is_same_v<T, long double>)
+        return "long double";
+    else if constexpr (std::is_same_v<T, fixed_t>)
+        return "q16.16";
+    else
+        static_assert(!std::is_same_v<T, T>, "No name for this result type");
+}
+
+/**
+ * Repeat a run until the minimum time has passed
+ * @param run Function performing a run of samplesPerRun evaluations, returning a checksum
+ * @return    Nanoseconds per evaluation
+ */
+template<class F>
+double measure(reporter const& rep, std::size_t samples, F&& run)
+{
+    // Keep the compiler from optimizing the evaluation away
+    volatile double sink = run();
+
+    std::size_t runs = 0;
+    auto const start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed{0};
+    do
+    {
+        sink = sink + run();
+        ++runs;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < rep.min_time_ms());
+
+    return elapsed.count() * 1e6 / (runs * samples);
+}
+
+template<typename T, int Dim>
+std::vector<point<T, Dim>> random_points()
+{
+    std::mt19937 rnd{1};
+    std::uniform_real_distribution<T> dist(T{-100}, T{100});
+    std::vector<point<T, Dim>> points(samplesPerRun);
+    for (auto& p : points)
+    {
+        for (auto& e : p)
+            e = dist(rnd);
+    }
+    return points;
+}
+
+template<class Gen>
+void bench_at(reporter const& rep, Gen const& gen, record r)
+{
+    using result_t = typename Gen::result_t;
+
+    auto const points = random_points<result_t, Gen::dimensions>();
+    r.mode = "at";
+    rep.report(r, measure(rep, points.size(), [&]() {
+                   double sum = 0;
+                   for (auto const& p : points)
+                       sum += gen.at(p);
+                   return sum;
+               }));
+}
+
+template<class Gen>
+void bench_batch(reporter const& rep, Gen const& gen, record r)
+{
+    using result_t = typename Gen::result_t;
+
+    auto const points = random_points<result_t, Gen::dimensions>();
+    std::vector<result_t> values(points.size());
+    r.mode = "batch";
+    rep.report(r, measure(rep, points.size(), [&]() {
+                   gen.at(points.begin(), points.end(), values.begin());
+                   return static_cast<double>(values.back());
+               }));
+}
+
+template<class Gen>
+void bench_packed(reporter const& rep, Gen const& gen, record r)
+{
+    using result_t = typename Gen::result_t;
+
+    auto const points = random_points<result_t, Gen::dimensions>();
+    r.mode = "packed";
+    rep.report(r, measure(rep, points.size(), [&]() {
+                   double sum = 0;
+                   for (auto const& p : points)
+                       sum += gen.at_packed(p);
+                   return sum;
+               }));
+}
+
+template<class Gen>
+void bench_grid(reporter const& rep, Gen const& gen, record r)
+{
+    using result_t = typename Gen::result_t;
+    constexpr int const Dim = Gen::dimensions;
+
+    // Roughly samplesPerRun points, sampled at 16 points per lattice cell along every axis
+    int const extent = std::max(
+        2, static_cast<int>(std::round(std::pow(double(samplesPerRun), 1.0 / Dim))));
+    point<result_t, Dim> origin;
+    vector<result_t, Dim> step;
+    point<int, Dim> extents;
+    for (int d = 0; d < Dim; ++d)
+    {
+        origin[d] = result_t(0.5) + d;
+        step[d] = result_t(1) / 16;
+        extents[d] = extent;
+    }
+
+    std::size_t samples = 1;
+    for (int d = 0; d < Dim; ++d)
+        samples *= extent;
+
+    std::vector<result_t> values(samples);
+    r.mode = "grid";
+    rep.report(r, measure(rep, samples, [&]() {
+                   gen.fill_grid(origin, step, extents, values.begin());
+                   return static_cast<double>(values.back());
+               }));
+}
+
+template<class Gen>
+void bench_volume(reporter const& rep, Gen const& gen, record r)
+{
+    using result_t = typename Gen::result_t;
+
+    // A 32^3 voxel volume, sampled at 16 points per lattice cell along every axis
+    constexpr int const extent = 32;
+    std::vector<result_t> values(extent * extent * extent);
+    r.mode = "volume";
+    rep.report(r, measure(rep, values.size(), [&]() {
+                   gen.fill_volume(point3d<result_t>(result_t(0.5), result_t(1.5), result_t(2.5)),
+                                   vec3d<result_t>::from_value(result_t(1) / 16),
+                                   point3d_i(0, 0, 0),
+                                   point3d_i(extent, extent, extent),
+                                   values.begin(),
+                                   {1, extent, extent * extent});
+                   return static_cast<double>(values.back());
+               }));
+}
+
+template<class Gen>
+void bench_construct(reporter const& rep, record r)
+{
+    using result_t = typename Gen::result_t;
+
+    r.mode = "construct";
+    rep.report(r, measure(rep, 1, [seed = 0u]() mutable {
+                   auto const gen = std::make_unique<Gen>(std::mt19937{seed++});
+                   return static_cast<double>(gen->at(point<result_t, Gen::dimensions>{}));
+               }));
+}
+
+template<typename T, int Dim, int Smoothness, int NumGradients>
+void bench_perlin(reporter const& rep)
+{
+    using Gen = perlin_noise_generator<Dim, Smoothness, T, NumGradients>;
+    auto const gen = std::make_unique<Gen>(std::mt19937{42});
+
+    record r;
+    r.generator = "perlin";
+    r.type = type_name<T>();
+    r.dim = Dim;
+    r.smoothness = Smoothness;
+    r.numGradients = NumGradients;
+    bench_at(rep, *gen, r);
+    bench_batch(rep, *gen, r);
+    bench_grid(rep, *gen, r);
+    if constexpr (has_fill_volume_v<Gen>)
+        bench_volume(rep, *gen, r);
+    bench_construct<Gen>(rep, r);
+}
+
+template<typename T, int Dim>
+void bench_hashed_perlin(reporter const& rep)
+{
+    using Gen = hashed_perlin_noise_generator<Dim, 2, T>;
+    auto const gen = std::make_unique<Gen>(std::mt19937{42});
+
+    record r;
+    r.generator = "hashed_perlin";
+    r.type = type_name<T>();
+    r.dim = Dim;
+    r.smoothness = 2;
+    bench_at(rep, *gen, r);
+    bench_batch(rep, *gen, r);
+    bench_grid(rep, *gen, r);
+    if constexpr (has_fill_volume_v<Gen>)
+        bench_volume(rep, *gen, r);
+    bench_construct<Gen>(rep, r);
+}
+
+template<typename T, int Dim>
+void bench_perlin(reporter const& rep)
+{
+    // Interpolation and hashing cost are independent, so smoothness is swept at the default
+    // gradient count and gradient count at the default smoothness. 255 exercises the generic
+    // hashing path next to the power-of-two ones.
+    static_for<4>([&](auto s) { bench_perlin<T, Dim, decltype(s)::value, 256>(rep); });
+    bench_perlin<T, Dim, 2, 16>(rep);
+    bench_perlin<T, Dim, 2, 255>(rep);
+    bench_perlin<T, Dim, 2, 4096>(rep);
+    bench_perlin<T, Dim, 2, 65536>(rep);
+    bench_hashed_perlin<T, Dim>(rep);
+}
+
+template<typename T, int... Dim>
+void bench_perlin(reporter const& rep, std::integer_sequence<int, Dim...>)
+{
+    (bench_perlin<T, Dim>(rep), ...);
+}
+
+template<typename T, int Dim>
+void bench_simplex(reporter const& rep)
+{
+    using Gen = simplex_noise_generator<Dim, T>;
+    auto const gen = std::make_unique<Gen>(std::mt19937{42});
+
+    record r;
+    r.generator = "simplex";
+    r.type = type_name<T>();
+    r.dim = Dim;
+    r.numGradients = 256;
+    bench_at(rep, *gen, r);
+    bench_construct<Gen>(rep, r);
+}
+
+template<typename T, int... Dim>
+void bench_simplex(reporter const& rep, std::integer_sequence<int, Dim...>)
+{
+    (bench_simplex<T, Dim>(rep), ...);
+}
+
+template<int Dim>
+void bench_fixed_perlin(reporter const& rep)
+{
+    using Gen = fixed_perlin_noise_generator<Dim>;
+    auto const gen = std::make_unique<Gen>(splitmix64{42});
+
+    // Same points as the floating point benchmarks
+    std::vector<point<fixed_t, Dim>> points;
+    for (auto const& p : random_points<double, Dim>())
+    {
+        point<fixed_t, Dim> fixed;
+        for (int d = 0; d < Dim; ++d)
+            fixed[d] = to_fixed(p[d]);
+        points.push_back(fixed);
+    }
+
+    record r;
+    r.generator = "fixed_perlin";
+    r.type = type_name<fixed_t>();
+    r.dim = Dim;
+    r.smoothness = Gen::smoothness;
+    r.numGradients = 256;
+
+    r.mode = "at";
+    rep.report(r, measure(rep, points.size(), [&]() {
+                   double sum = 0;
+                   for (auto const& p : points)
+                       sum += gen->at(p);
+                   return sum;
+               }));
+
+    std::vector<fixed_t> values(points.size());
+    r.mode = "batch";
+    rep.report(r, measure(rep, points.size(), [&]() {
+                   gen->at(points.begin(), points.end(), values.begin());
+                   return static_cast<double>(values.back());
+               }));
+}
+
+template<int... Dim>
+void bench_fixed_perlin(reporter const& rep, std::integer_sequence<int, Dim...>)
+{
+    (bench_fixed_perlin<Dim>(rep), ...);
+}
+
+template<class NoiseGen, int Octaves>
+void bench_fractal(reporter const& rep, std::string const& name)
+{
+    using T = typename NoiseGen::result_t;
+    using Gen
+        = fractal_noise_generator<NoiseGen, Octaves, exponential_decay<T>, exponential_growth<T>>;
+    auto const gen = std::make_unique<Gen>(std::mt19937{42});
+
+    record r;
+    r.generator = name;
+    r.type = type_name<T>();
+    r.dim = Gen::dimensions;
+    r.octaves = Octaves;
+    bench_at(rep, *gen, r);
+    bench_batch(rep, *gen, r);
+    if constexpr (has_batch_at_v<NoiseGen>)
+        bench_packed(rep, *gen, r);
+    if constexpr (has_fill_volume_v<Gen>)
+        bench_volume(rep, *gen, r);
+}
+
+template<class NoiseGen, int... Octaves>
+void bench_fractal(reporter const& rep,
+                   std::string const& name,
+                   std::integer_sequence<int, Octaves...>)
+{
+    (bench_fractal<NoiseGen, Octaves>(rep, name), ...);
+}
+
+template<class NoiseGen>
+void bench_seamless(reporter const& rep, std::string const& name, int octaves)
+{
+    using Gen = seamless_noise_generator_2d<NoiseGen, 6, 4>;
+    auto const gen = std::make_unique<Gen>(std::mt19937{42});
+
+    record r;
+    r.generator = name;
+    r.type = type_name<typename Gen::result_t>();
+    r.dim = Gen::dimensions;
+    r.octaves = octaves;
+    bench_at(rep, *gen, r);
+    bench_grid(rep, *gen, r);
+    bench_construct<Gen>(rep, r);
+}
+
+template<typename T>
+void bench_expression(reporter const& rep)
+{
+    using Gen = perlin_noise_generator<2, 2, T>;
+    std::vector<std::unique_ptr<Gen>> gens;
+    for (unsigned seed = 0; seed < 5; ++seed)
+        gens.push_back(std::make_unique<Gen>(std::mt19937{42 + seed}));
+
+    // Terrain-like expression: plains or warped ridges, chosen by a control noise
+    auto const plains = scale_bias(source(*gens[1]), T(0.25), T(-0.5));
+    auto const ridges = ridged(warp(source(*gens[2]), T(0.5), source(*gens[3]), source(*gens[4])));
+    auto const expr = select(source(*gens[0]), plains, ridges, T(0), T(0.1));
+
+    record r;
+    r.generator = "expression";
+    r.type = type_name<T>();
+    r.dim = 2;
+    bench_at(rep, expr, r);
+    bench_batch(rep, expr, r);
+    bench_grid(rep, expr, r);
+}
+
+template<typename T>
+void bench_all(reporter const& rep)
+{
+    using dims = std::integer_sequence<int, 1, 2, 3, 4, 5, 6>;
+    using octaves = std::integer_sequence<int, 1, 2, 4, 8, 10>;
+
+    bench_perlin<T>(rep, dims{});
+    bench_simplex<T>(rep, dims{});
+    bench_expression<T>(rep);
+    bench_fractal<perlin_noise_generator<2, 2, T>>(rep, "fractal_perlin", octaves{});
+    bench_fractal<perlin_noise_generator<3, 2, T>>(rep, "fractal_perlin", octaves{});
+    bench_fractal<perlin_noise_generator<4, 2, T>>(rep, "fractal_perlin", octaves{});
+    bench_fractal<simplex_noise_generator<4, T>>(rep, "fractal_simplex", octaves{});
+    bench_seamless<perlin_noise_generator<4, 2, T>>(rep, "seamless_perlin", -1);
+    bench_seamless<simplex_noise_generator<4, T>>(rep, "seamless_simplex", -1);
+    bench_seamless<fractal_noise_generator<perlin_noise_generator<4, 2, T>,
+                                           10,
+                                           exponential_decay<T>,
+                                           exponential_growth<T>>>(
+        rep, "seamless_fractal_perlin", 10);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    config cfg;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--json") == 0)
+            cfg.json = true;
+        else if (std::strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc)
+            cfg.minTimeMs = std::stod(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json] [--min-time-ms <ms>]" << std::endl;
+            return 1;
+        }
+    }
+
+    reporter rep{cfg};
+    bench_all<float>(rep);
+    bench_all<double>(rep);
+    bench_fixed_perlin(rep, std::integer_sequence<int, 1, 2, 3, 4, 5, 6>{});
+
+    return 0;
+}
@@ -0,0 +1,565 @@
+#include "perlin/animated_noise_field.h"
+#include "perlin/chunk_manager.h"
+#include "perlin/fixed_perlin_noise_generator.h"
+#include "perlin/fractal_noise_generator.h"
+#include "perlin/gradient_table_file.h"
+#include "perlin/hashed_gradients.h"
+#include "perlin/instrumentation.h"
+#include "perlin/noise_expression.h"
+#include "perlin/noise_map_renderer.h"
+#include "perlin/noise_pyramid.h"
+#include "perlin/perlin_noise_generator.h"
+#include "perlin/point.h"
+#include "perlin/quantize.h"
+#include "perlin/thread_pool.h"
+#include "perlin/tile_cache.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * Checks the invariants the headers document, printing every violated one. Returns a non-zero
+ * exit code if any check fails, so that it can run as a test.
+ */
+
+using namespace noise;
+
+namespace
+{
+int failures = 0;
+
+void check(bool condition, char const* what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << what << '\n';
+        ++failures;
+    }
+}
+
+void check_tile_cache(thread_pool& pool)
+{
+    using gen_t = perlin_noise_generator<2>;
+    using cache_t = tile_cache<gen_t, 16>;
+
+    gen_t const gen(std::mt19937{42});
+    point2d_f const origin{-1.5f, 2.f};
+    vec2d_f const step{0.05f, 0.05f};
+    cache_t cache(gen, origin, step, cache_t::tile_bytes * 4);
+
+    // Tiles at level 0 are sections of the full map
+    std::vector<float> expected(16 * 16);
+    render_noise_map_section(pool, gen, origin, step, point2d_i{48, -32}, point2d_i{16, 16},
+                             expected.begin());
+    auto const tile = cache.get(point2d_i{3, -2});
+    check(tile && *tile == expected, "tile_cache: level 0 tile equals render_noise_map_section");
+    check(cache.get(point2d_i{3, -2}) == tile, "tile_cache: repeated request returns cached tile");
+    check(cache.hits() == 1 && cache.misses() == 1, "tile_cache: one hit and one miss");
+
+    // Filling the budget evicts the least recently used tile, which stays valid for its holders
+    for (int x = 0; x < 4; ++x)
+        cache.get(point2d_i{x, 0});
+    check(cache.misses() == 5 && cache.evictions() == 1, "tile_cache: fifth tile evicts one");
+    check(cache.memory_usage() == cache_t::tile_bytes * 4, "tile_cache: stays within budget");
+    check(*tile == expected, "tile_cache: evicted tile stays valid");
+    cache.get(point2d_i{3, -2});
+    check(cache.misses() == 6 && cache.evictions() == 2, "tile_cache: evicted tile is rendered");
+    cache.get(point2d_i{3, -2}, 1);
+    check(cache.misses() == 7, "tile_cache: levels of detail are cached separately");
+
+    cache.clear();
+    check(cache.memory_usage() == 0, "tile_cache: clear removes all tiles");
+
+    // Coarse levels of generators with a footprint omit the octaves finer than a pixel
+    using fractal_t = fractal_noise_generator<gen_t, 6>;
+    fractal_t const fractal(std::mt19937{42});
+    tile_cache<fractal_t, 16> fractalCache(fractal, origin, step, cache_t::tile_bytes * 4);
+    auto const coarse = fractalCache.get(point2d_i{1, 2}, 3);
+    bool coarseMatches = true;
+    bool octavesOmitted = false;
+    for (int y = 0; y < 16; ++y)
+    {
+        for (int x = 0; x < 16; ++x)
+        {
+            point2d_f const p{origin[0] + static_cast<float>(16 + x) * step[0] * 8,
+                              origin[1] + static_cast<float>(32 + y) * step[1] * 8};
+            auto const value = (*coarse)[y * 16 + x];
+            coarseMatches = coarseMatches && value == fractal.at(p, step[0] * 8, 0.f);
+            octavesOmitted = octavesOmitted || value != fractal.at(p);
+        }
+    }
+    check(coarseMatches, "tile_cache: coarse tiles pass the pixel spacing as footprint");
+    check(octavesOmitted, "tile_cache: coarse tiles omit fine octaves");
+}
+
+/**
+ * @return Whether a frame of a 2d field matches at() of the 3d generator within rounding errors
+ */
+template<class Gen>
+bool frame_matches(Gen const& gen,
+                   std::vector<float> const& frame,
+                   point2d_f const& origin,
+                   vec2d_f const& step,
+                   point2d_i const& extents,
+                   float time)
+{
+    auto const tolerance = 16 * std::numeric_limits<float>::epsilon();
+    for (int y = 0; y < extents[1]; ++y)
+    {
+        for (int x = 0; x < extents[0]; ++x)
+        {
+            point3d_f const p{origin[0] + static_cast<float>(x) * step[0],
+                              origin[1] + static_cast<float>(y) * step[1],
+                              time};
+            if (std::abs(frame[y * extents[0] + x] - gen.at(p)) > tolerance)
+                return false;
+        }
+    }
+    return true;
+}
+
+void check_animated_noise_field(thread_pool& pool)
+{
+    using gen_t = perlin_noise_generator<3>;
+    gen_t const gen(std::mt19937{42});
+    point2d_f const origin{-1.5f, 2.f};
+    vec2d_f const step{0.07f, 0.05f};
+    point2d_i const extents{70, 50};
+
+    animated_noise_field<gen_t> field(gen, origin, step, extents, 0.25f);
+    animated_noise_field<gen_t> serial(gen, origin, step, extents, 0.25f);
+    check(frame_matches(gen, field.frame(), origin, step, extents, 0.25f),
+          "animated_noise_field: first frame equals at()");
+
+    bool matches = true;
+    bool identical = true;
+    for (int i = 0; i < 12; ++i)
+    {
+        field.advance(pool, 0.125f);
+        serial.advance(0.125f);
+        matches = matches && frame_matches(gen, field.frame(), origin, step, extents, field.time());
+        identical = identical && field.frame() == serial.frame();
+    }
+    check(matches, "animated_noise_field: frames equal at() across time cells");
+    check(identical, "animated_noise_field: parallel frames equal serial ones");
+    check(field.refreshes() == 2, "animated_noise_field: coefficients refreshed once per cell");
+
+    // The previous frame stays unchanged while the next one is rendered
+    auto const& previous = field.frame();
+    auto const copy = previous;
+    field.advance(pool, 0.125f);
+    check(previous == copy && &field.frame() != &previous,
+          "animated_noise_field: frames are double-buffered");
+
+    field.set_time(pool, -3.7f);
+    check(frame_matches(gen, field.frame(), origin, step, extents, -3.7f),
+          "animated_noise_field: negative times equal at()");
+}
+
+/**
+ * @return Whether the points origin + k * direction for 0 <= k < 64 have distinct hashes, and
+ * fewer than half of them share the gradient of the origin
+ */
+template<int Dim>
+bool line_varies(hashed_gradients<Dim> const& gradients, point<int, Dim> const& direction)
+{
+    using gradients_t = hashed_gradients<Dim>;
+
+    point<int, Dim> const origin{};
+    auto const first = gradients.at(origin);
+    std::unordered_set<std::uint32_t> hashes;
+    int repeats = 0;
+    for (int k = 0; k < 64; ++k)
+    {
+        point<int, Dim> p;
+        auto hash = gradients.seed();
+        for (int d = 0; d < Dim; ++d)
+        {
+            p[d] = origin[d] + k * direction[d];
+            hash = gradients_t::combine(hash, p[d]);
+        }
+        hashes.insert(gradients_t::finalize(hash));
+
+        auto const gradient = gradients.at(p);
+        repeats += std::equal(gradient.begin(), gradient.end(), first.begin()) ? 1 : 0;
+    }
+    return hashes.size() == 64 && repeats < 32;
+}
+
+/**
+ * @return Whether packed evaluation of a fixed point generator equals evaluating every point
+ */
+template<class Gen>
+bool fixed_packs_match(Gen const& gen)
+{
+    splitmix64 rnd{7};
+    std::vector<point<fixed_t, Gen::dimensions>> points(100);
+    for (auto& p : points)
+    {
+        for (auto& c : p)
+            c = static_cast<fixed_t>(constexpr_uniform_int(rnd, 1u << 26)) - (1 << 25);
+    }
+    std::vector<fixed_t> values(points.size());
+    gen.at(points.begin(), points.end(), values.begin());
+    for (std::size_t i = 0; i < points.size(); ++i)
+    {
+        if (values[i] != gen.at(points[i]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Generator whose values are NaN left of the origin, e.g. a control derived from invalid input
+ */
+struct nan_generator
+{
+    using result_t = float;
+    static constexpr const int dimensions = 2;
+
+    float at(point2d_f const& p) const noexcept
+    {
+        return p[0] < 0 ? std::numeric_limits<float>::quiet_NaN() : std::sin(p[0] * 3 + p[1]);
+    }
+};
+
+void check_noise_expression()
+{
+    nan_generator const control{};
+    perlin_noise_generator<2> const lower(std::mt19937{1});
+    perlin_noise_generator<2> const upper(std::mt19937{2});
+    auto const expr = select(source(control), source(lower), source(upper), 0.f, 0.3f);
+
+    // Blocks with NaN controls only, and blocks mixing them with all three ranges
+    point2d_f const origin{-4.f, 0.5f};
+    vec2d_f const step{0.05f, 0.1f};
+    point2d_i const extents{200, 3};
+    std::vector<float> values(extents[0] * extents[1]);
+    expr.fill_grid(origin, step, extents, values.begin());
+    bool matches = true;
+    for (int y = 0; y < extents[1]; ++y)
+    {
+        for (int x = 0; x < extents[0]; ++x)
+        {
+            point2d_f const p{origin[0] + static_cast<float>(x) * step[0],
+                              origin[1] + static_cast<float>(y) * step[1]};
+            auto const expected = expr.at(p);
+            auto const value = values[y * extents[0] + x];
+            matches = matches && std::memcmp(&value, &expected, sizeof(value)) == 0;
+        }
+    }
+    check(matches, "noise_select: fused evaluation with NaN controls equals at()");
+}
+
+void check_fixed_perlin_noise_generator()
+{
+    // The tables hash like gradient_table, for sizes with and without a doubled permutation table
+    constexpr fixed_perlin_noise_generator<3> gen(splitmix64{42});
+    constexpr fixed_perlin_noise_generator<3, 2, 100> npot(splitmix64{42});
+    check(fixed_packs_match(gen) && fixed_packs_match(npot),
+          "fixed_perlin_noise_generator: packed evaluation equals at()");
+}
+
+void check_gradient_table_file()
+{
+    using gen_t = perlin_noise_generator<3, 2, float, 255>;
+    using mapped_t = mapped_perlin_noise_generator<3, 2, float, 255>;
+
+    // Written to the working directory, which is the build directory when run by CTest
+    std::string const path = "perlin_check_gradients.bin";
+    gen_t const gen(std::mt19937{42});
+    check(save_gradient_table(gen.gradients(), path), "gradient_table_file: table is saved");
+
+    {
+        gradient_table_file const file(path);
+        check(file.is_open() && file.holds<gen_t>() && file.holds<mapped_t>(),
+              "gradient_table_file: file holds the table");
+        check(!file.holds<perlin_noise_generator<3>>()
+                  && !file.holds<mapped_perlin_noise_generator<3, 2, double, 255>>(),
+              "gradient_table_file: other table types are rejected");
+
+        mapped_t const mapped(file.view<mapped_t>());
+        gen_t const copy(file.view<gen_t>());
+        std::mt19937 engine{7};
+        std::uniform_real_distribution<float> dist(-100.f, 100.f);
+        std::vector<point3d_f> points(1000);
+        for (auto& p : points)
+            p = point3d_f{dist(engine), dist(engine), dist(engine)};
+        bool matches = true;
+        for (auto const& p : points)
+            matches = matches && mapped.at(p) == gen.at(p) && copy.at(p) == gen.at(p);
+        check(matches, "gradient_table_file: mapped and copied generators equal the owning one");
+
+        std::vector<float> expected(points.size());
+        std::vector<float> values(points.size());
+        gen.at(points.begin(), points.end(), expected.begin());
+        mapped.at(points.begin(), points.end(), values.begin());
+        check(values == expected, "gradient_table_file: mapped batch evaluation equals owning");
+
+        point3d_f const origin{-1.3f, 0.2f, 4.f};
+        vec3d_f const step{0.07f, 0.11f, 0.05f};
+        point<int, 3> const extents{9, 7, 5};
+        expected.resize(9 * 7 * 5);
+        values.resize(expected.size());
+        gen.fill_grid(origin, step, extents, expected.begin());
+        mapped.fill_grid(origin, step, extents, values.begin());
+        check(values == expected, "gradient_table_file: mapped grid equals owning");
+    }
+
+    // Truncated files are rejected
+    {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        std::vector<char> start(256);
+        auto const read = file ? std::fread(start.data(), 1, start.size(), file) : 0;
+        if (file)
+            std::fclose(file);
+        file = std::fopen(path.c_str(), "wb");
+        if (file)
+        {
+            std::fwrite(start.data(), 1, read, file);
+            std::fclose(file);
+        }
+    }
+    check(!gradient_table_file(path).is_open(), "gradient_table_file: truncated file is rejected");
+    std::remove(path.c_str());
+    check(!gradient_table_file(path).is_open(), "gradient_table_file: missing file is rejected");
+}
+
+void check_hashed_gradients()
+{
+    hashed_gradients<2> const gradients2(std::mt19937{42});
+    bool lines2 = true;
+    for (auto const& direction : {point2d_i{1, 0}, point2d_i{0, 1}, point2d_i{3, 1},
+                                  point2d_i{1, 3}, point2d_i{1, -1}, point2d_i{5, 7}})
+        lines2 = lines2 && line_varies(gradients2, direction);
+    check(lines2, "hashed_gradients: 2d lattice lines don't repeat gradients");
+
+    hashed_gradients<3> const gradients3(std::mt19937{42});
+    bool lines3 = true;
+    for (auto const& direction : {point<int, 3>{5, 0, 1}, point<int, 3>{1, 1, 1},
+                                  point<int, 3>{3, 1, 0}, point<int, 3>{0, 0, 1}})
+        lines3 = lines3 && line_varies(gradients3, direction);
+    check(lines3, "hashed_gradients: 3d lattice lines don't repeat gradients");
+
+    // The packed path of perlin_noise_generator hashes lane by lane and must agree
+    using gen_t = perlin_noise_generator<3, 2, float, 256, int, hashed_gradients>;
+    gen_t const gen(std::mt19937{42});
+    std::mt19937 engine{7};
+    std::uniform_real_distribution<float> dist(-20.f, 20.f);
+    std::vector<point3d_f> points(100);
+    for (auto& p : points)
+        p = point3d_f{dist(engine), dist(engine), dist(engine)};
+    std::vector<float> values(points.size());
+    gen.at(points.begin(), points.end(), values.begin());
+    bool packedMatches = true;
+    for (std::size_t i = 0; i < points.size(); ++i)
+        packedMatches = packedMatches && values[i] == gen.at(points[i]);
+    check(packedMatches, "hashed_gradients: packed evaluation equals at()");
+}
+
+void check_instrumentation()
+{
+    // The configuration of the README, with tags of its own to start from zero
+    using octaves_t = counting_instrumentation<struct check_octaves>;
+    using terrain_t = counting_instrumentation<struct check_terrain>;
+    using octave_gen_t = perlin_noise_generator<2, 2, float, 256, int, gradient_table, octaves_t>;
+    using gen_t = fractal_noise_generator<octave_gen_t, 6, hyperbolic_decay<float>,
+                                          linear_growth<float>, 1, terrain_t>;
+
+    gen_t const gen(std::mt19937{42});
+    for (int i = 0; i < 10; ++i)
+        gen.at(point2d_f{0.3f * static_cast<float>(i), -0.7f});
+
+    auto const terrain = terrain_t::snapshot();
+    auto const octaves = octaves_t::snapshot();
+    check(terrain[counter::samples] == 10 && terrain[counter::corners] == 0,
+          "instrumentation: fractal generator counts its own samples");
+    check(octaves[counter::samples] == 60 && octaves[counter::corners] == 60 * 4
+              && octaves[counter::gradient_lookups] == 60 * 4,
+          "instrumentation: inner generator counts corners and gradient lookups");
+}
+
+void check_noise_pyramid(thread_pool& pool)
+{
+    perlin_noise_generator<2> const gen(std::mt19937{42});
+    point2d_f const origin{-1.5f, 2.f};
+    vec2d_f const step{0.03f, 0.02f};
+    point2d_i const extents{150, 100};
+
+    mip_chain const chain(extents);
+    check(chain.num_levels() == 8 && chain.extents(7) == point2d_i{1, 1},
+          "noise_pyramid: levels down to a single pixel");
+    std::vector<float> levels(chain.size());
+    render_noise_pyramid(pool, gen, origin, step, chain, levels.begin());
+
+    std::vector<float> map(extents[0] * extents[1]);
+    render_noise_map(pool, gen, origin, step, extents, map.begin());
+    check(std::equal(map.begin(), map.end(), levels.begin()),
+          "noise_pyramid: level 0 equals render_noise_map");
+
+    // Tiles of more than 4096 pixels are filled in bands of rows
+    std::vector<float> banded(chain.size());
+    render_noise_pyramid<128>(pool, gen, origin, step, chain, banded.begin());
+    check(banded == levels, "noise_pyramid: bands of large tiles equal small tiles");
+
+    // Pixels of coarse levels sample the center of the pixels of level 0 they cover
+    auto const& extents3 = chain.extents(3);
+    bool centered = true;
+    for (int y = 0; y < extents3[1]; ++y)
+    {
+        for (int x = 0; x < extents3[0]; ++x)
+        {
+            point2d_f const p{origin[0] + 3.5f * step[0] + static_cast<float>(x) * step[0] * 8,
+                              origin[1] + 3.5f * step[1] + static_cast<float>(y) * step[1] * 8};
+            centered = centered && levels[chain.offset(3) + y * extents3[0] + x] == gen.at(p);
+        }
+    }
+    check(centered, "noise_pyramid: coarse pixels sample their centers");
+
+    // Chains starting at a coarse level and other tile sizes give the same levels
+    mip_chain const coarse(extents, 3, 2);
+    std::vector<float> coarseLevels(coarse.size());
+    render_noise_pyramid<16>(pool, gen, origin, step, coarse, coarseLevels.begin());
+    check(std::equal(coarseLevels.begin(), coarseLevels.end(), levels.begin() + chain.offset(2)),
+          "noise_pyramid: coarse chains equal the levels of the full chain");
+
+    // Fractal generators omit the octaves finer than a pixel of the level
+    using fractal_t = fractal_noise_generator<perlin_noise_generator<2>, 6>;
+    fractal_t const fractal(std::mt19937{42});
+    render_noise_pyramid(pool, fractal, origin, step, chain, levels.begin());
+    check(levels[chain.offset(4)]
+              == fractal.at(point2d_f{origin[0] + 7.5f * step[0], origin[1] + 7.5f * step[1]},
+                            step[0] * 16,
+                            0.f),
+          "noise_pyramid: fractal levels pass the pixel spacing as footprint");
+}
+
+void check_quantized_noise_map(thread_pool& pool)
+{
+    perlin_noise_generator<2> const gen(std::mt19937{42});
+    point2d_f const origin{-1.5f, 2.f};
+    vec2d_f const step{0.03f, 0.02f};
+    point2d_i const first{5, -7};
+    point2d_i const extents{300, 200};
+    quantizer<unorm16> const quantize;
+
+    std::vector<std::uint16_t> expected(extents[0] * extents[1]);
+    for (int y = 0; y < extents[1]; ++y)
+    {
+        for (int x = 0; x < extents[0]; ++x)
+        {
+            point2d_f const p{origin[0] + static_cast<float>(first[0] + x) * step[0],
+                              origin[1] + static_cast<float>(first[1] + y) * step[1]};
+            expected[y * extents[0] + x] = quantize(gen.at(p));
+        }
+    }
+
+    // Tiles of more than 4096 values are filled in bands of rows
+    std::vector<std::uint16_t> map(expected.size());
+    render_quantized_noise_map_section(
+        pool, gen, origin, step, first, extents, map.begin(), quantize);
+    check(map == expected, "render_quantized_noise_map_section: equals quantized at()");
+    std::fill(map.begin(), map.end(), 0);
+    render_quantized_noise_map_section<128>(
+        pool, gen, origin, step, first, extents, map.begin(), quantize);
+    check(map == expected, "render_quantized_noise_map_section: bands of large tiles equal at()");
+}
+
+/**
+ * @return Whether the last samples of a chunk along a dimension equal the first samples of the
+ * next chunk along it, compared bitwise
+ */
+template<class Manager>
+bool shares_border(Manager const& chunks, typename Manager::chunk_coord_t const& chunk, int dim)
+{
+    auto next = chunk;
+    ++next[dim];
+    auto const a = chunks.find(chunk);
+    auto const b = chunks.find(next);
+    if (!a || !b)
+        return false;
+
+    std::size_t stride = 1;
+    for (int d = 0; d < dim; ++d)
+        stride *= Manager::chunk_samples;
+    std::size_t const last = Manager::chunk_size * stride;
+    for (std::size_t i = 0; i < a->size(); ++i)
+    {
+        if (i / stride % Manager::chunk_samples == 0
+            && std::memcmp(&(*a)[i + last], &(*b)[i], sizeof((*b)[i])) != 0)
+            return false;
+    }
+    return true;
+}
+
+void check_chunk_manager(thread_pool& pool)
+{
+    using gen2_t = perlin_noise_generator<2>;
+    gen2_t const gen2(std::mt19937{42});
+    chunk_manager<gen2_t, 8> chunks2(gen2, point2d_f{-1.5f, 2.f}, vec2d_f{0.1f, 0.07f}, 1);
+    int const focus = chunks2.add_focus(point2d_f{0.f, 0.f});
+    check(chunks2.update(pool) == 9 && chunks2.size() == 9, "chunk_manager: view radius 1");
+    auto const center = chunks2.chunk_of(point2d_f{0.f, 0.f});
+    check(shares_border(chunks2, center, 0) && shares_border(chunks2, center, 1),
+          "chunk_manager: 2d chunk borders are bit-identical");
+
+    // Chunks within the keep radius survive, the others are replaced within the update limit
+    chunks2.move_focus(focus, point2d_f{1.f, 0.f});
+    auto const moved = chunks2.chunk_of(point2d_f{1.f, 0.f});
+    check(chunks2.update(2) == 2, "chunk_manager: update limit");
+    chunks2.update();
+    check(chunks2.find(center) != nullptr, "chunk_manager: chunks within keep radius are kept");
+    check(shares_border(chunks2, moved, 0), "chunk_manager: new chunk borders are bit-identical");
+    chunks2.move_focus(focus, point2d_f{2.f, 0.f});
+    chunks2.update();
+    check(chunks2.size() == 9 + 3 && chunks2.find(center) == nullptr,
+          "chunk_manager: chunks out of range are discarded");
+
+    using gen3_t = perlin_noise_generator<3>;
+    gen3_t const gen3(std::mt19937{42});
+    chunk_manager<gen3_t, 4> chunks3(
+        gen3, point3d_f{0.3f, -2.f, 1.f}, vec3d_f{0.2f, 0.1f, 0.3f}, 1);
+    chunks3.add_focus(point3d_f{0.f, 0.f, 0.f});
+    chunks3.update(pool);
+    auto const center3 = chunks3.chunk_of(point3d_f{0.f, 0.f, 0.f});
+    check(shares_border(chunks3, center3, 0) && shares_border(chunks3, center3, 1)
+              && shares_border(chunks3, center3, 2),
+          "chunk_manager: 3d chunk borders are bit-identical");
+}
+
+} // namespace
+
+int main()
+{
+    thread_pool pool(3);
+
+    check_animated_noise_field(pool);
+    check_chunk_manager(pool);
+    check_fixed_perlin_noise_generator();
+    check_gradient_table_file();
+    check_hashed_gradients();
+    check_instrumentation();
+    check_noise_expression();
+    check_noise_pyramid(pool);
+    check_quantized_noise_map(pool);
+    check_tile_cache(pool);
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
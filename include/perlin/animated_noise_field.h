@@ -0,0 +1,312 @@
+/**********************************************************
+ * @file   animated_noise_field.h
+ * @author jan
+ * @date   7/28/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_ANIMATED_NOISE_FIELD_H
+#define PERLINNOISE_ANIMATED_NOISE_FIELD_H
+
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/thread_pool.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace noise
+{
+/**
+ * A regular grid of noise values animated over time.
+ *
+ * @details The last dimension of the generator is used as time, so a 3d generator animates a 2d
+ * field and a 4d generator a 3d field. The field samples the points origin + i * step for all
+ * 0 <= i < extents, in row-major order with the first dimension varying fastest.
+ *
+ *          Within a lattice cell of the time axis, Perlin noise at a fixed point in space is
+ * lerp(a0 + b0 * t0, a1 + b1 * t1, smoothstep(t0)), where t0 and t1 are the offsets from the lower
+ * and upper cell boundary in time. The coefficients only depend on the spatial position and the
+ * time cell. They are computed for every sample once the time enters a new cell, which costs about
+ * as much as rendering a frame with fill_grid(). Every other frame only evaluates the expression
+ * above, a handful of operations per sample.
+ *
+ *          As the spatial interpolation is done before adding the time terms, values differ from
+ * at() by rounding errors of a few multiples of std::numeric_limits<result_t>::epsilon().
+ *
+ *          Frames are double-buffered: A frame returned by frame() stays valid and unchanged while
+ * the next frame is rendered, e.g. to upload it from another thread. It is only overwritten by the
+ * frame after.
+ *
+ * @tparam Gen perlin_noise_generator of at least 2 dimensions
+ */
+template<class Gen>
+class animated_noise_field
+{
+  public:
+    static_assert(Gen::dimensions >= 2, "Need at least one spatial dimension besides time");
+
+    using result_t = typename Gen::result_t;
+    using grid_coord_t = typename Gen::grid_coord_t;
+
+    static constexpr const int dimensions = Gen::dimensions - 1; // Spatial dimensions
+
+    /**
+     * @param gen     Noise generator, which must outlive the field
+     * @param origin  Point of the field at index 0
+     * @param step    Distance between adjacent samples along each dimension
+     * @param extents Number of samples along each dimension
+     * @param time    Time of the first frame
+     */
+    animated_noise_field(Gen const& gen,
+                         point<result_t, dimensions> const& origin,
+                         vector<result_t, dimensions> const& step,
+                         point<int, dimensions> const& extents,
+                         result_t time = 0)
+        : m_gen(gen)
+        , m_extents(extents)
+    {
+        std::size_t numSamples = 1;
+        for (int d = 0; d < dimensions; ++d)
+        {
+            m_axes[d].resize(std::max(extents[d], 0));
+            for (int i = 0; i < extents[d]; ++i)
+            {
+                m_axes[d][i] = axis_sample::make(origin[d]
+                                                 + static_cast<result_t>(i) * step[d]);
+            }
+            numSamples *= m_axes[d].size();
+        }
+        m_coefficients.resize(numSamples);
+        for (auto& buffer : m_buffers)
+            buffer.resize(numSamples);
+
+        render(nullptr, time);
+    }
+
+    animated_noise_field(animated_noise_field const&) = delete;
+    animated_noise_field& operator=(animated_noise_field const&) = delete;
+
+    /**
+     * Render the frame at a given time
+     * @param time Time of the frame
+     */
+    void set_time(result_t time) { render(nullptr, time); }
+
+    /**
+     * Render the frame at a given time in parallel
+     * @param pool Thread pool to render on
+     * @param time Time of the frame
+     */
+    void set_time(thread_pool& pool, result_t time) { render(&pool, time); }
+
+    /**
+     * Render the frame a time step after the current one
+     * @param dt Time step
+     */
+    void advance(result_t dt) { render(nullptr, m_time + dt); }
+
+    /**
+     * Render the frame a time step after the current one in parallel
+     * @param pool Thread pool to render on
+     * @param dt   Time step
+     */
+    void advance(thread_pool& pool, result_t dt) { render(&pool, m_time + dt); }
+
+    /**
+     * @return Time of the current frame
+     */
+    result_t time() const noexcept { return m_time; }
+
+    /**
+     * @return Noise values of the current frame in row-major order
+     */
+    std::vector<result_t> const& frame() const noexcept { return m_buffers[m_front]; }
+
+    /**
+     * @return Number of times the coefficients were recomputed, i.e. the time entered a new cell
+     */
+    std::size_t refreshes() const noexcept { return m_refreshes; }
+
+  private:
+    static constexpr const int s_numNeighbors = ipow(2, Gen::dimensions);
+    static constexpr const int s_numSpatialNeighbors = s_numNeighbors / 2;
+
+    /**
+     * Lattice data of a single coordinate along one axis
+     */
+    struct axis_sample
+    {
+        grid_coord_t cell;
+        std::array<result_t, 2> offsets; // Offsets from the lower and upper cell boundary
+        result_t weight;                 // Interpolation weight of the upper cell boundary
+
+        static axis_sample make(result_t coord) noexcept
+        {
+            auto const cell = constexpr_floor<grid_coord_t>(coord);
+            return {cell,
+                    {coord - static_cast<result_t>(cell), coord - static_cast<result_t>(cell + 1)},
+                    smoothstep<Gen::smoothness>(coord - static_cast<result_t>(cell))};
+        }
+    };
+
+    /**
+     * Time-independent terms of a sample within a time cell
+     */
+    struct coefficients
+    {
+        result_t a0; // Value at the lower cell boundary
+        result_t b0; // Time derivative at the lower cell boundary
+        result_t a1; // Value at the upper cell boundary
+        result_t b1; // Time derivative at the upper cell boundary
+    };
+
+    Gen const& m_gen;
+    point<int, dimensions> m_extents;
+    std::array<std::vector<axis_sample>, dimensions> m_axes;
+    std::vector<coefficients> m_coefficients;
+    std::array<std::vector<result_t>, 2> m_buffers;
+    int m_front = 0;
+    result_t m_time = 0;
+    grid_coord_t m_timeCell = 0;
+    bool m_valid = false; // Whether the coefficients belong to m_timeCell
+    std::size_t m_refreshes = 0;
+
+    void render(thread_pool* pool, result_t time)
+    {
+        auto const timeCell = constexpr_floor<grid_coord_t>(time);
+        if (!m_valid || timeCell != m_timeCell)
+        {
+            m_timeCell = timeCell;
+            for_rows(pool, [this](std::size_t row) { refresh_row(row); });
+            m_valid = true;
+            ++m_refreshes;
+        }
+
+        auto const t0 = time - static_cast<result_t>(timeCell);
+        auto const t1 = time - static_cast<result_t>(timeCell + 1);
+        auto const weight = smoothstep<Gen::smoothness>(t0);
+        auto& buffer = m_buffers[1 - m_front];
+        for_rows(pool, [&](std::size_t row) {
+            std::size_t const begin = row * m_axes[0].size();
+            std::size_t const end = begin + m_axes[0].size();
+            for (std::size_t k = begin; k < end; ++k)
+            {
+                auto const& c = m_coefficients[k];
+                auto const lower = c.a0 + c.b0 * t0;
+                auto const upper = c.a1 + c.b1 * t1;
+                buffer[k] = std::clamp(lower + weight * (upper - lower),
+                                       static_cast<result_t>(-1),
+                                       static_cast<result_t>(1));
+            }
+        });
+
+        m_front = 1 - m_front;
+        m_time = time;
+    }
+
+    /**
+     * Call a function for every row along the first dimension, in parallel if a pool is given
+     */
+    template<class F>
+    void for_rows(thread_pool* pool, F&& fun) const
+    {
+        if (m_axes[0].empty())
+            return;
+
+        std::size_t const numRows = m_coefficients.size() / m_axes[0].size();
+        if (pool != nullptr)
+            pool->parallel_for(numRows, fun);
+        else
+        {
+            for (std::size_t row = 0; row < numRows; ++row)
+                fun(row);
+        }
+    }
+
+    /**
+     * Recompute the coefficients of a row for the current time cell
+     */
+    void refresh_row(std::size_t row) noexcept
+    {
+        // Index of the row along all but the first dimension
+        point<int, dimensions> idx{};
+        for (int d = 1, rest = static_cast<int>(row); d < dimensions; ++d)
+        {
+            idx[d] = rest % m_extents[d];
+            rest /= m_extents[d];
+        }
+
+        point<grid_coord_t, Gen::dimensions> baseGridPoint;
+        for (int d = 1; d < dimensions; ++d)
+            baseGridPoint[d] = m_axes[d][idx[d]].cell;
+        baseGridPoint[dimensions] = m_timeCell;
+
+        std::array<result_t, dimensions> weights;
+        for (int d = 1; d < dimensions; ++d)
+            weights[d] = m_axes[d][idx[d]].weight;
+
+        decltype(m_gen.gradients_at(baseGridPoint)) gradients{};
+        std::array<result_t, s_numNeighbors> spatialDots;
+        std::array<result_t, s_numNeighbors> timeGradients;
+        auto out = m_coefficients.begin() + row * m_axes[0].size();
+        for (std::size_t i = 0; i < m_axes[0].size(); ++i)
+        {
+            idx[0] = static_cast<int>(i);
+            weights[0] = m_axes[0][i].weight;
+
+            if (i == 0 || m_axes[0][i].cell != m_axes[0][i - 1].cell)
+            {
+                baseGridPoint[0] = m_axes[0][i].cell;
+                gradients = m_gen.gradients_at(baseGridPoint);
+            }
+
+            // Split the dot products into the spatial part and the time gradient
+            for (int n = 0; n < s_numNeighbors; ++n)
+            {
+                result_t dp = 0;
+                for (int d = 0; d < dimensions; ++d)
+                    dp = dp + gradients[n][d] * m_axes[d][idx[d]].offsets[(n >> d) & 1];
+                spatialDots[n] = dp;
+                timeGradients[n] = gradients[n][dimensions];
+            }
+
+            // Corners at the lower time boundary come first, followed by the upper ones
+            *out++ = {interpolate_spatial(spatialDots.data(), weights),
+                      interpolate_spatial(timeGradients.data(), weights),
+                      interpolate_spatial(spatialDots.data() + s_numSpatialNeighbors, weights),
+                      interpolate_spatial(timeGradients.data() + s_numSpatialNeighbors, weights)};
+        }
+    }
+
+    /**
+     * Interpolate values at the corners of a spatial lattice cell
+     *
+     * @param values  Values at the corners, ordered like in perlin_noise_generator
+     * @param weights Smoothed interpolation weights along every spatial dimension
+     * @return        Interpolated value
+     */
+    static result_t interpolate_spatial(result_t const* values,
+                                        std::array<result_t, dimensions> const& weights) noexcept
+    {
+        std::array<result_t, s_numSpatialNeighbors> v;
+        std::copy_n(values, s_numSpatialNeighbors, v.begin());
+
+        int s = s_numSpatialNeighbors;
+        for (int d = 0; d < dimensions; ++d)
+        {
+            for (int i = 0; i < s; i += 2)
+                v[i / 2] = v[i] + weights[d] * (v[i + 1] - v[i]);
+            s /= 2;
+        }
+        return v[0];
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_ANIMATED_NOISE_FIELD_H
@@ -0,0 +1,363 @@
+/**********************************************************
+ * @file   chunk_manager.h
+ * @author jan
+ * @date   7/26/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_CHUNK_MANAGER_H
+#define PERLINNOISE_CHUNK_MANAGER_H
+
+#include "perlin/generator_traits.h"
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/thread_pool.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace noise
+{
+/**
+ * Generates chunks of an unbounded noise field on demand around moving focus points.
+ *
+ * @details The field is sampled at origin + i * step for all integral sample indices i. The chunk
+ * c holds the samples c * ChunkSize <= i <= (c + 1) * ChunkSize, i.e. ChunkSize + 1 samples along
+ * every dimension in row-major order with the first dimension varying fastest. Adjacent chunks
+ * share their border samples, which are computed from the same index and are therefore
+ * bit-identical.
+ *
+ *          Every focus point requires the chunks within a view radius around its own chunk,
+ * measured in chunks along every dimension. Chunks are kept as long as they are within the keep
+ * radius of any focus point, so that moving back and forth doesn't regenerate them. update()
+ * generates the missing chunks closest to the focus points first, and a limit on the number of
+ * chunks per update bounds its latency. Chunks around predicted positions can be requested with
+ * prefetch().
+ *
+ *          The manager itself isn't thread-safe. Chunks are shared and may be read from any thread,
+ * even after the manager discarded them.
+ *
+ * @tparam Gen       Noise generator
+ * @tparam ChunkSize Number of sample intervals along every dimension of a chunk
+ */
+template<class Gen, int ChunkSize = 64>
+class chunk_manager
+{
+  public:
+    static_assert(ChunkSize > 0, "Chunks must not be empty");
+
+    using result_t = typename Gen::result_t;
+    using chunk_t = std::vector<result_t>;
+    using chunk_ptr = std::shared_ptr<chunk_t const>;
+
+    static constexpr const int dimensions = Gen::dimensions;
+    static constexpr const int chunk_size = ChunkSize;
+    static constexpr const int chunk_samples = ChunkSize + 1; // Samples along every dimension
+
+    using position_t = point<result_t, dimensions>;
+    using chunk_coord_t = point<int, dimensions>;
+
+    /**
+     * @param gen        Noise generator, which must outlive the manager
+     * @param origin     Sample with index 0
+     * @param step       Distance between adjacent samples along every dimension
+     * @param viewRadius Radius in chunks around a focus point that is generated
+     * @param keepRadius Radius in chunks around a focus point that is kept, at least viewRadius
+     */
+    chunk_manager(Gen const& gen,
+                  position_t const& origin,
+                  vector<result_t, dimensions> const& step,
+                  int viewRadius,
+                  int keepRadius)
+        : m_gen(gen)
+        , m_origin(origin)
+        , m_step(step)
+        , m_viewRadius(std::max(viewRadius, 0))
+        , m_keepRadius(std::max(keepRadius, m_viewRadius))
+    {
+    }
+
+    /**
+     * @param gen        Noise generator, which must outlive the manager
+     * @param origin     Sample with index 0
+     * @param step       Distance between adjacent samples along every dimension
+     * @param viewRadius Radius in chunks around a focus point that is generated. Chunks one
+     * further out are kept.
+     */
+    chunk_manager(Gen const& gen,
+                  position_t const& origin,
+                  vector<result_t, dimensions> const& step,
+                  int viewRadius)
+        : chunk_manager(gen, origin, step, viewRadius, viewRadius + 1)
+    {
+    }
+
+    /**
+     * @param position Initial position of the focus point
+     * @return         Identifier of the new focus point
+     */
+    int add_focus(position_t const& position)
+    {
+        m_foci.emplace_back(m_nextFocusId, chunk_of(position));
+        return m_nextFocusId++;
+    }
+
+    /**
+     * @param id       Identifier of a focus point
+     * @param position New position of the focus point
+     */
+    void move_focus(int id, position_t const& position)
+    {
+        for (auto& focus : m_foci)
+        {
+            if (focus.first == id)
+                focus.second = chunk_of(position);
+        }
+    }
+
+    /**
+     * @param id Identifier of a focus point to remove
+     */
+    void remove_focus(int id)
+    {
+        m_foci.erase(std::remove_if(m_foci.begin(),
+                                    m_foci.end(),
+                                    [id](auto const& focus) { return focus.first == id; }),
+                     m_foci.end());
+    }
+
+    /**
+     * Request the chunks within the view radius around a predicted position.
+     *
+     * @details Prefetched chunks are generated by the next update() after all chunks required by
+     * the focus points. They are kept if they are within the keep radius of a focus point.
+     * Requests only apply to the next update(), so predictions are meant to be renewed before
+     * every update.
+     *
+     * @param position Predicted position of a focus point
+     */
+    void prefetch(position_t const& position) { m_prefetches.push_back(chunk_of(position)); }
+
+    /**
+     * Discard chunks out of range and generate missing ones.
+     *
+     * @param maxChunks Maximum number of chunks to generate
+     * @return          Number of generated chunks
+     */
+    std::size_t update(std::size_t maxChunks = std::numeric_limits<std::size_t>::max())
+    {
+        return update_impl(nullptr, maxChunks);
+    }
+
+    /**
+     * Discard chunks out of range and generate missing ones in parallel.
+     *
+     * @param pool      Thread pool to generate chunks on
+     * @param maxChunks Maximum number of chunks to generate
+     * @return          Number of generated chunks
+     */
+    std::size_t update(thread_pool& pool,
+                       std::size_t maxChunks = std::numeric_limits<std::size_t>::max())
+    {
+        return update_impl(&pool, maxChunks);
+    }
+
+    /**
+     * @param chunk Chunk coordinates
+     * @return      The chunk, or nullptr if it isn't generated
+     */
+    chunk_ptr find(chunk_coord_t const& chunk) const
+    {
+        auto iter = m_chunks.find(chunk);
+        return iter != m_chunks.end() ? iter->second : nullptr;
+    }
+
+    /**
+     * @param position Any position
+     * @return         Coordinates of the chunk containing the position
+     */
+    chunk_coord_t chunk_of(position_t const& position) const noexcept
+    {
+        chunk_coord_t chunk;
+        for (int d = 0; d < dimensions; ++d)
+        {
+            chunk[d] = static_cast<int>(
+                std::floor((position[d] - m_origin[d]) / (m_step[d] * ChunkSize)));
+        }
+        return chunk;
+    }
+
+    /**
+     * @return Number of generated chunks
+     */
+    std::size_t size() const noexcept { return m_chunks.size(); }
+
+  private:
+    struct chunk_hash
+    {
+        std::size_t operator()(chunk_coord_t const& chunk) const noexcept
+        {
+            std::size_t hash = 0;
+            for (int d = 0; d < dimensions; ++d)
+                hash = hash * 31 + std::hash<int>{}(chunk[d]);
+            return hash;
+        }
+    };
+
+    Gen const& m_gen;
+    position_t m_origin;
+    vector<result_t, dimensions> m_step;
+    int m_viewRadius;
+    int m_keepRadius;
+
+    int m_nextFocusId = 0;
+    std::vector<std::pair<int, chunk_coord_t>> m_foci;
+    std::vector<chunk_coord_t> m_prefetches;
+    std::unordered_map<chunk_coord_t, chunk_ptr, chunk_hash> m_chunks;
+
+    static int distance(chunk_coord_t const& a, chunk_coord_t const& b) noexcept
+    {
+        int result = 0;
+        for (int d = 0; d < dimensions; ++d)
+            result = std::max(result, std::abs(a[d] - b[d]));
+        return result;
+    }
+
+    std::size_t update_impl(thread_pool* pool, std::size_t maxChunks)
+    {
+        // Discard chunks out of range
+        for (auto iter = m_chunks.begin(); iter != m_chunks.end();)
+        {
+            bool const keep = std::any_of(m_foci.begin(), m_foci.end(), [&](auto const& focus) {
+                return distance(iter->first, focus.second) <= m_keepRadius;
+            });
+            iter = keep ? std::next(iter) : m_chunks.erase(iter);
+        }
+
+        // Missing chunks ordered by priority: Required before prefetched, then by distance
+        std::vector<std::pair<int, chunk_coord_t>> missing;
+        auto request = [&](chunk_coord_t const& center, int priorityOffset) {
+            chunk_coord_t chunk = center;
+            for (int d = 0; d < dimensions; ++d)
+                chunk[d] -= m_viewRadius;
+            do
+            {
+                if (m_chunks.count(chunk) == 0)
+                    missing.emplace_back(priorityOffset + distance(chunk, center), chunk);
+            } while (next_chunk(chunk, center));
+        };
+        for (auto const& focus : m_foci)
+            request(focus.second, 0);
+        for (auto const& prefetch : m_prefetches)
+            request(prefetch, m_viewRadius + 1);
+        m_prefetches.clear();
+
+        std::stable_sort(missing.begin(), missing.end(), [](auto const& a, auto const& b) {
+            return a.first < b.first;
+        });
+        std::vector<chunk_coord_t> chunks;
+        std::unordered_set<chunk_coord_t, chunk_hash> selected;
+        for (auto const& m : missing)
+        {
+            if (chunks.size() >= maxChunks)
+                break;
+            if (selected.insert(m.second).second)
+                chunks.push_back(m.second);
+        }
+
+        std::vector<chunk_ptr> generated(chunks.size());
+        auto generateChunk = [&](std::size_t i) { generated[i] = generate(chunks[i]); };
+        if (pool != nullptr)
+            pool->parallel_for(chunks.size(), generateChunk);
+        else
+        {
+            for (std::size_t i = 0; i < chunks.size(); ++i)
+                generateChunk(i);
+        }
+
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+            m_chunks.emplace(chunks[i], std::move(generated[i]));
+        return chunks.size();
+    }
+
+    /**
+     * Advance to the next chunk within the view radius around a center chunk
+     *
+     * @return false if there is no next chunk
+     */
+    bool next_chunk(chunk_coord_t& chunk, chunk_coord_t const& center) const noexcept
+    {
+        for (int d = 0; d < dimensions; ++d)
+        {
+            if (++chunk[d] <= center[d] + m_viewRadius)
+                return true;
+            chunk[d] = center[d] - m_viewRadius;
+        }
+        return false;
+    }
+
+    chunk_ptr generate(chunk_coord_t const& chunk) const
+    {
+        chunk_coord_t first;
+        chunk_coord_t extents;
+        std::size_t numSamples = 1;
+        for (int d = 0; d < dimensions; ++d)
+        {
+            first[d] = chunk[d] * ChunkSize;
+            extents[d] = chunk_samples;
+            numSamples *= chunk_samples;
+        }
+
+        auto values = std::make_shared<chunk_t>(numSamples);
+        if constexpr (has_fill_volume_v<Gen>)
+        {
+            m_gen.fill_volume(m_origin,
+                              m_step,
+                              first,
+                              extents,
+                              values->data(),
+                              {1, chunk_samples, chunk_samples * chunk_samples});
+        }
+        else if constexpr (has_fill_grid_v<Gen>)
+        {
+            m_gen.fill_grid(m_origin, m_step, first, extents, values->data());
+        }
+        else
+        {
+            std::vector<position_t> points(numSamples);
+            std::array<int, dimensions> idx{};
+            for (auto& p : points)
+            {
+                for (int d = 0; d < dimensions; ++d)
+                    p[d] = m_origin[d] + static_cast<result_t>(first[d] + idx[d]) * m_step[d];
+                for (int d = 0; d < dimensions && ++idx[d] == chunk_samples; ++d)
+                    idx[d] = 0;
+            }
+
+            if constexpr (has_batch_at_v<Gen>)
+                m_gen.at(points.data(), points.data() + points.size(), values->data());
+            else
+            {
+                std::transform(points.begin(), points.end(), values->begin(), [this](auto& p) {
+                    return m_gen.at(p);
+                });
+            }
+        }
+        return values;
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_CHUNK_MANAGER_H
@@ -0,0 +1,152 @@
+/**********************************************************
+ * @file   colormap.h
+ * @author jan
+ * @date   7/27/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_COLORMAP_H
+#define PERLINNOISE_COLORMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace noise
+{
+/**
+ * Piecewise constant mapping of noise values to colors, compiled into a lookup table.
+ *
+ * @details A colormap consists of stops, each a threshold and a color. A value is mapped to the
+ * color of the highest threshold below it, i.e. the same color a std::map<T, Color> from
+ * thresholds to colors yields through --lower_bound(value). Values not above the lowest threshold
+ * are mapped to its color.
+ *
+ *          The range [min, max] is divided into equally sized bins, each storing the stop in effect
+ * at its start. The number of bins is chosen so that no bin contains more than one threshold, so a
+ * lookup takes one table access and at most one comparison instead of a tree walk. Only thresholds
+ * closer than (max - min) / 2^16 to each other need more comparisons. Lookups are exact for all
+ * values, including values outside of [min, max].
+ *
+ * @tparam Color Color type
+ * @tparam T     Noise value type
+ */
+template<class Color, typename T = float>
+class colormap
+{
+  public:
+    using color_t = Color;
+    using value_t = T;
+
+    /**
+     * @param stops Non-empty list of thresholds and colors in any order. If a threshold appears
+     * more than once, its first color is used.
+     * @param min   Lowest value covered by the lookup table
+     * @param max   Highest value covered by the lookup table
+     */
+    explicit colormap(std::vector<std::pair<T, Color>> stops, T min = T{-1}, T max = T{1})
+        : m_min(min)
+    {
+        std::stable_sort(stops.begin(), stops.end(), [](auto const& a, auto const& b) {
+            return a.first < b.first;
+        });
+        stops.erase(std::unique(stops.begin(),
+                                stops.end(),
+                                [](auto const& a, auto const& b) { return a.first == b.first; }),
+                    stops.end());
+
+        for (std::size_t i = 0; i < stops.size(); ++i)
+        {
+            m_colors.push_back(stops[i].second);
+            m_next.push_back(i + 1 < stops.size() ? stops[i + 1].first
+                                                  : std::numeric_limits<T>::infinity());
+        }
+
+        // Double the number of bins until every bin contains at most one threshold
+        std::vector<std::uint32_t> count;
+        for (std::size_t bins = s_minBins;; bins *= 2)
+        {
+            m_scale = static_cast<T>(bins) / (max - min);
+            m_lastBin = static_cast<T>(bins - 1);
+
+            count.assign(bins, 0);
+            bool separated = true;
+            for (std::size_t i = 1; i < stops.size(); ++i)
+                separated &= ++count[bin(stops[i].first)] <= 1;
+            if (separated || bins >= s_maxBins)
+                break;
+        }
+
+        // Every bin starts in the stop following all thresholds of previous bins
+        m_table.resize(count.size());
+        std::uint32_t segment = 0;
+        for (std::size_t b = 0; b < count.size(); ++b)
+        {
+            m_table[b] = segment;
+            segment += count[b];
+        }
+    }
+
+    /**
+     * @param value Noise value
+     * @return      Color of the value
+     */
+    Color const& operator()(T value) const noexcept { return m_colors[segment(value)]; }
+
+    /**
+     * Map a range of noise values to colors, e.g. a row of a noise map.
+     *
+     * @tparam InputIt  Input iterator over noise values
+     * @tparam OutputIt Output iterator accepting colors
+     * @param first     First noise value
+     * @param last      One past the last noise value
+     * @param out       Destination of the colors
+     * @return          Output iterator one past the last written color
+     */
+    template<class InputIt, class OutputIt>
+    OutputIt apply(InputIt first, InputIt last, OutputIt out) const
+    {
+        for (; first != last; ++first)
+            *out++ = m_colors[segment(*first)];
+        return out;
+    }
+
+    /**
+     * @return Number of bins of the lookup table
+     */
+    std::size_t table_size() const noexcept { return m_table.size(); }
+
+  private:
+    static constexpr std::size_t const s_minBins = 256;
+    static constexpr std::size_t const s_maxBins = std::size_t{1} << 16;
+
+    T m_min;
+    T m_scale;
+    T m_lastBin;
+    std::vector<std::uint32_t> m_table; // Stop in effect at the start of every bin
+    std::vector<T> m_next;              // Threshold of the following stop for every stop
+    std::vector<Color> m_colors;
+
+    std::size_t bin(T value) const noexcept
+    {
+        // Clamps NaN to the first bin. Written as min and max to avoid branches.
+        T const pos = std::min(std::max(T{0}, (value - m_min) * m_scale), m_lastBin);
+        return static_cast<std::size_t>(pos);
+    }
+
+    std::size_t segment(T value) const noexcept
+    {
+        std::size_t segment = m_table[bin(value)];
+        while (value > m_next[segment])
+            ++segment;
+        return segment;
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_COLORMAP_H
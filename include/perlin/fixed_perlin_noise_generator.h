@@ -0,0 +1,292 @@
+/**********************************************************
+ * @file   fixed_perlin_noise_generator.h
+ * @author jan
+ * @date   7/25/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_FIXED_PERLIN_NOISE_GENERATOR_H
+#define PERLINNOISE_FIXED_PERLIN_NOISE_GENERATOR_H
+
+#include "perlin/fixed_point.h"
+#include "perlin/gradient_table.h"
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/random.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace noise
+{
+/**
+ * Generates perlin noise in arbitrary dimensions using integer arithmetic only.
+ *
+ * @details Coordinates and noise values are Q16.16 fixed point numbers (see fixed_point.h).
+ * Gradients are stored as 16 bit integers with 14 fractional bits, dot products and interpolation
+ * are computed on 32 bit integers. The noise is therefore bit-exact across compilers and CPUs, as
+ * long as the generator is constructed from the same seed.
+ *
+ *          Tables are generated from a splitmix64 engine without any floating point arithmetic,
+ * because the standard engines and distributions aren't portable between standard libraries.
+ * Construction can be evaluated at compile time.
+ *
+ *          Noise is generated in the [-1,1] domain, i.e. values are in [-fixed_one, fixed_one].
+ * Coordinates must be within [-2^15, 2^15).
+ *
+ * @tparam Dim          Dimensionality of the noise function
+ * @tparam Smoothness   Order of smoothstep function to use for interpolation, at most 5
+ * @tparam NumGradients Amount of random gradients to use. A larger number results in more
+ * randomness, but longer computation times. Powers of two are considerably faster to evaluate.
+ */
+template<int Dim, int Smoothness = 2, int NumGradients = 256>
+class fixed_perlin_noise_generator
+{
+  public:
+    static_assert(Dim > 0, "Must have at least one dimension");
+    static_assert(Smoothness >= 0, "Smoothness must be positive");
+    static_assert(NumGradients > 0, "Must allow at least one pre-computed gradient");
+
+    using result_t = fixed_t;
+    using grid_coord_t = std::int32_t;
+
+    static constexpr const int dimensions = Dim;
+    static constexpr const int smoothness = Smoothness;
+
+    /**
+     * @param rnd Random engine for noise generation
+     */
+    constexpr explicit fixed_perlin_noise_generator(splitmix64& rnd) noexcept
+    {
+        shuffle_permutations<NumGradients>(m_permutations, rnd);
+
+        // Uniformly distributed directions by rejection sampling from a ball. Short vectors are
+        // rejected as well, since their direction is poorly resolved.
+        constexpr std::int64_t const maxSqMag = std::int64_t{s_gradientOne} * s_gradientOne;
+        for (auto& gradient : m_gradients)
+        {
+            std::array<std::int64_t, Dim> vec{};
+            std::int64_t sqMag = 0;
+            do
+            {
+                sqMag = 0;
+                for (int d = 0; d < Dim; ++d)
+                {
+                    vec[d] = static_cast<std::int64_t>(
+                                 constexpr_uniform_int(rnd, 2 * s_gradientOne + 1))
+                             - s_gradientOne;
+                    sqMag += vec[d] * vec[d];
+                }
+            } while (sqMag > maxSqMag || sqMag < maxSqMag / 16);
+
+            // Magnitude with 10 additional fractional bits
+            auto const mag = isqrt(sqMag << 20);
+            for (int d = 0; d < Dim; ++d)
+            {
+                auto const component = std::clamp<std::int64_t>(
+                    vec[d] * (std::int64_t{1} << 24) / mag, -s_gradientOne, s_gradientOne);
+                gradient[d] = static_cast<std::int16_t>(component);
+            }
+        }
+    }
+
+    /**
+     * @param rnd Random engine for noise generation
+     */
+    constexpr explicit fixed_perlin_noise_generator(splitmix64&& rnd) noexcept
+        : fixed_perlin_noise_generator(rnd)
+    {
+    }
+
+    /**
+     * Evaluate the noise function at a given point.
+     *
+     * @param p Fixed point coordinates of the point of evaluation
+     * @return  Fixed point noise function value at the specified point
+     */
+    constexpr result_t at(point<fixed_t, Dim> const& p) const noexcept
+    {
+        point<grid_coord_t, Dim> baseGridPoint;
+        std::array<fixed_t, Dim> offsets{};
+        for (int d = 0; d < Dim; ++d)
+        {
+            baseGridPoint[d] = p[d] >> fixed_fraction_bits;
+            offsets[d] = p[d] & fixed_fraction_mask;
+        }
+
+        // Compute dot products between gradients and vectors from neighboring grid nodes to point
+        std::array<fixed_t, s_numNeighbors> dot_products{};
+        for (int n = 0; n < s_numNeighbors; ++n)
+        {
+            auto gridPoint = baseGridPoint;
+            for (int d = 0; d < Dim; ++d)
+                gridPoint[d] += (n >> d) & 1;
+
+            auto const& gradient = gradient_at(gridPoint);
+            fixed_t dp = 0;
+            for (int d = 0; d < Dim; ++d)
+                dp += dot_term(gradient[d], offsets[d] - (((n >> d) & 1) << fixed_fraction_bits));
+            dot_products[n] = dp;
+        }
+
+        // Interpolate dot products
+        std::array<fixed_t, Dim> weights{};
+        for (int d = 0; d < Dim; ++d)
+            weights[d] = fixed_smoothstep<Smoothness>(offsets[d]);
+
+        int s = s_numNeighbors;
+        for (int d = 0; d < Dim; ++d)
+        {
+            for (int i = 0; i < s; i += 2)
+            {
+                auto const diff = dot_products[i + 1] - dot_products[i];
+                dot_products[i / 2] = dot_products[i] + fixed_mul(diff, weights[d]);
+            }
+            s /= 2;
+        }
+
+        return std::clamp(dot_products[0], -fixed_one, fixed_one);
+    }
+
+    /**
+     * Evaluate the noise function at multiple points.
+     *
+     * @details Points are processed in packs of s_packSize, with every step of the evaluation
+     * done for the whole pack at once on structure-of-arrays data. This maps the pack onto integer
+     * SIMD lanes. The results are identical to evaluating every point on its own.
+     *
+     * @tparam InputIt  Input iterator over point<fixed_t, Dim>
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param first     Begin of the range of evaluation points
+     * @param last      End of the range of evaluation points
+     * @param out       Destination of the noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class InputIt, class OutputIt>
+    OutputIt at(InputIt first, InputIt last, OutputIt out) const noexcept
+    {
+        pack<fixed_t> coords{};
+        std::array<result_t, s_packSize> values{};
+        while (first != last)
+        {
+            int n = 0;
+            for (; n < s_packSize && first != last; ++n, ++first)
+            {
+                auto const& p = *first;
+                for (int d = 0; d < Dim; ++d)
+                    coords[d][n] = p[d];
+            }
+
+            // Unused lanes of the last pack keep their previous coordinates
+            at_pack(coords, values);
+            out = std::copy_n(values.begin(), n, out);
+        }
+        return out;
+    }
+
+  private:
+    static constexpr const int s_numNeighbors = ipow(2, Dim);
+    static constexpr const int s_packSize = 8;
+
+    // Gradient components have 14 fractional bits
+    static constexpr const int s_gradientBits = 14;
+    static constexpr const std::int32_t s_gradientOne = 1 << s_gradientBits;
+
+    template<typename T>
+    using pack = std::array<std::array<T, s_packSize>, Dim>;
+
+    using permutation_traits = permutation_table_traits<NumGradients>;
+
+    std::array<typename permutation_traits::permutation_t, permutation_traits::size>
+        m_permutations{};
+    std::array<std::array<std::int16_t, Dim>, NumGradients> m_gradients{};
+
+    /**
+     * Product of a gradient component and a node vector component
+     *
+     * @details Every product is scaled to Q16.16 on its own. Summing unscaled products could
+     * overflow 32 bits in four or more dimensions.
+     * @param gradient Gradient component with s_gradientBits fractional bits
+     * @param offset   Fixed point node vector component in [-1, 1]
+     * @return         Fixed point product
+     */
+    static constexpr fixed_t dot_term(std::int16_t gradient, fixed_t offset) noexcept
+    {
+        return (gradient * offset) >> s_gradientBits;
+    }
+
+    /**
+     * @param gridPoint Grid point
+     * @return          Gradient assigned to the grid point, hashed like in gradient_table
+     */
+    constexpr std::array<std::int16_t, Dim> const& gradient_at(
+        point<grid_coord_t, Dim> const& gridPoint) const noexcept
+    {
+        return m_gradients[gradient_index<NumGradients>(m_permutations, gridPoint)];
+    }
+
+    /**
+     * Evaluate the noise function at a pack of points
+     *
+     * @param coords Fixed point coordinates of the points, one lane per point
+     * @param values Noise values, one lane per point
+     */
+    void at_pack(pack<fixed_t> const& coords,
+                 std::array<result_t, s_packSize>& values) const noexcept
+    {
+        pack<grid_coord_t> reducedCells;
+        pack<fixed_t> offsets;
+        pack<fixed_t> weights;
+        for (int d = 0; d < Dim; ++d)
+        {
+            for (int l = 0; l < s_packSize; ++l)
+            {
+                reducedCells[d][l]
+                    = reduce_grid_coord<NumGradients>(coords[d][l] >> fixed_fraction_bits);
+                offsets[d][l] = coords[d][l] & fixed_fraction_mask;
+                weights[d][l] = fixed_smoothstep<Smoothness>(offsets[d][l]);
+            }
+        }
+        std::array<std::array<fixed_t, s_packSize>, s_numNeighbors> dot_products;
+        for (int n = 0; n < s_numNeighbors; ++n)
+        {
+            std::array<grid_coord_t, s_packSize> idx;
+            gradient_indices<NumGradients>(m_permutations, reducedCells, n, idx);
+
+            auto& dp = dot_products[n];
+            dp.fill(0);
+            for (int d = 0; d < Dim; ++d)
+            {
+                auto const corner = ((n >> d) & 1) << fixed_fraction_bits;
+                for (int l = 0; l < s_packSize; ++l)
+                    dp[l] += dot_term(m_gradients[idx[l]][d], offsets[d][l] - corner);
+            }
+        }
+
+        // Interpolate dot products
+        int s = s_numNeighbors;
+        for (int d = 0; d < Dim; ++d)
+        {
+            for (int i = 0; i < s; i += 2)
+            {
+                for (int l = 0; l < s_packSize; ++l)
+                {
+                    auto const diff = dot_products[i + 1][l] - dot_products[i][l];
+                    dot_products[i / 2][l] = dot_products[i][l] + fixed_mul(diff, weights[d][l]);
+                }
+            }
+            s /= 2;
+        }
+
+        for (int l = 0; l < s_packSize; ++l)
+            values[l] = std::clamp(dot_products[0][l], -fixed_one, fixed_one);
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_FIXED_PERLIN_NOISE_GENERATOR_H
@@ -0,0 +1,131 @@
+/**********************************************************
+ * @file   fixed_point.h
+ * @author jan
+ * @date   7/25/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_FIXED_POINT_H
+#define PERLINNOISE_FIXED_POINT_H
+
+#include "perlin/math.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace noise
+{
+/**
+ * Q16.16 fixed point numbers
+ *
+ * @details A value x is stored as the 32 bit integer x * 2^16. All operations only use integer
+ * arithmetic and therefore give the same results on every compiler and CPU. Right shifts of
+ * negative numbers are assumed to be arithmetic, which all supported compilers guarantee.
+ */
+using fixed_t = std::int32_t;
+
+constexpr int const fixed_fraction_bits = 16;
+constexpr fixed_t const fixed_one = fixed_t{1} << fixed_fraction_bits;
+constexpr fixed_t const fixed_fraction_mask = fixed_one - 1;
+
+/**
+ * Convert a floating point number to fixed point
+ * @tparam T Floating point type
+ * @param x  Number within the range of Q16.16
+ * @return   Closest fixed point number
+ */
+template<typename T>
+constexpr fixed_t to_fixed(T x) noexcept
+{
+    static_assert(std::is_floating_point_v<T>, "T must be a floating point type");
+
+    return static_cast<fixed_t>(constexpr_floor<std::int64_t>(x * fixed_one + T{0.5}));
+}
+
+/**
+ * Convert a fixed point number to floating point
+ * @tparam T Floating point type
+ * @param x  Fixed point number
+ * @return   Value of the fixed point number
+ */
+template<typename T>
+constexpr T from_fixed(fixed_t x) noexcept
+{
+    static_assert(std::is_floating_point_v<T>, "T must be a floating point type");
+
+    return static_cast<T>(x) / fixed_one;
+}
+
+/**
+ * Multiply two fixed point numbers, rounding towards negative infinity
+ *
+ * @details Splits a into its integer and fractional part, so that neither partial product
+ * overflows 32 bits. This keeps the multiplication on 32 bit integer lanes when vectorized.
+ * @param a Fixed point number
+ * @param b Fixed point number in [0, 1]
+ * @return  a * b
+ */
+constexpr fixed_t fixed_mul(fixed_t a, fixed_t b) noexcept
+{
+    auto const fraction = static_cast<std::uint32_t>(a & fixed_fraction_mask);
+    return (a >> fixed_fraction_bits) * b
+           + static_cast<fixed_t>((fraction * static_cast<std::uint32_t>(b))
+                                  >> fixed_fraction_bits);
+}
+static_assert(fixed_mul(fixed_one, fixed_one) == fixed_one);
+static_assert(fixed_mul(3 * fixed_one, fixed_one / 2) == 3 * fixed_one / 2);
+static_assert(fixed_mul(-3 * fixed_one, fixed_one / 2) == -3 * fixed_one / 2);
+static_assert(fixed_mul(-1, fixed_one / 2) == -1);
+static_assert(fixed_mul(fixed_one - 1, fixed_one) == fixed_one - 1);
+
+/**
+ * Smoothstep function in fixed point
+ *
+ * @details Evaluates the same polynomials as smoothstep() in math.h using integer arithmetic only.
+ * 0 and 1 are mapped exactly to itself.
+ * @tparam N Function order, at most 5 to keep intermediate values within 32 bits
+ * @param x  Fixed point evaluation point
+ * @return   Fixed point result in [0, 1]
+ */
+template<int N>
+constexpr fixed_t fixed_smoothstep(fixed_t x) noexcept
+{
+    static_assert(N >= 0, "N must be a nonnegative integer");
+    static_assert(N <= 5, "Higher orders overflow 32 bit intermediate values");
+
+    if (x <= 0)
+        return 0;
+    if (x >= fixed_one)
+        return fixed_one;
+
+    if constexpr (N == 0)
+    {
+        return x;
+    }
+    else
+    {
+        // Horner's scheme on the coefficients of the polynomial in -x
+        fixed_t sum = n_choose_k(2 * N, N) * fixed_one;
+        for (int n = N - 1; n >= 0; --n)
+            sum = n_choose_k(N + n, n) * n_choose_k(2 * N + 1, N - n) * fixed_one
+                  - fixed_mul(sum, x);
+
+        // Multiplying by x one at a time keeps the rounding error at a few units in the last place.
+        // Rounding errors of a precomputed power of x would be amplified by large sums.
+        for (int n = 0; n <= N; ++n)
+            sum = fixed_mul(sum, x);
+        return sum;
+    }
+}
+static_assert(fixed_smoothstep<0>(fixed_one / 2) == fixed_one / 2);
+static_assert(fixed_smoothstep<1>(-fixed_one) == 0);
+static_assert(fixed_smoothstep<1>(fixed_one / 2) == fixed_one / 2);
+static_assert(fixed_smoothstep<2>(fixed_one / 2) == fixed_one / 2);
+static_assert(fixed_smoothstep<2>(2 * fixed_one) == fixed_one);
+static_assert(fixed_smoothstep<5>(fixed_one / 2) == fixed_one / 2);
+
+} // namespace noise
+
+#endif // PERLINNOISE_FIXED_POINT_H
@@ -9,12 +9,21 @@
 #ifndef PERLINNOISE_FRACTAL_NOISE_GENERATOR_H
 #define PERLINNOISE_FRACTAL_NOISE_GENERATOR_H
 
+#include "perlin/generator_traits.h"
+#include "perlin/instrumentation.h"
 #include "perlin/math.h"
 #include "perlin/point.h"
+#include "perlin/vector.h"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <random>
 #include <ratio>
+#include <type_traits>
+#include <vector>
 
 namespace noise
 {
@@ -95,12 +104,15 @@ class gaussian_decay
  * @tparam WeightFun    Weighting function
  * @tparam FrequencyFun Frequency function
  * @tparam Contrast     Order of the smoothstep function to use
+ * @tparam Instrumentation Policy counting samples and evaluated or skipped octaves and timing every
+ * octave, e.g. counting_instrumentation. The default no_instrumentation compiles to nothing.
  */
 template<class Gen,
          int Octaves = 3,
          class WeightFun = hyperbolic_decay<typename Gen::result_t>,
          class FrequencyFun = linear_growth<typename Gen::result_t>,
-         int Contrast = 1>
+         int Contrast = 1,
+         class Instrumentation = no_instrumentation>
 class fractal_noise_generator
 {
   public:
@@ -124,6 +136,10 @@ class fractal_noise_generator
         std::generate(m_frequencies.begin(),
                       m_frequencies.end(),
                       [freqFun = FrequencyFun(), i = 0]() mutable { return freqFun(i++); });
+
+        result_t remaining = 0;
+        for (int i = Octaves - 1; i >= 0; --i)
+            m_remainingWeights[i] = remaining += std::abs(m_weights[i]);
     }
 
     /**
@@ -134,14 +150,320 @@ class fractal_noise_generator
      */
     result_t at(point<result_t, dimensions> const& p) const noexcept
     {
+        Instrumentation::count(counter::samples);
+
         result_t result = 0;
         for (int i = 0; i < Octaves; ++i)
+        {
+            auto const start = Instrumentation::cycles();
             result += m_noiseGen.at(pointAtOctave(p, i)) * m_weights[i];
+            Instrumentation::add_octave(i, 1, Instrumentation::cycles() - start);
+        }
+
+        return smoothstep<Contrast>((result + 1) / 2.f) * 2.f - 1;
+    }
+
+    /**
+     * Evaluate the noise function at a given point, evaluating all octaves at once.
+     *
+     * @details Requires the underlying generator to evaluate ranges of points at once. The
+     * octaves of the point are passed to it as one range, so that a generator processing packs
+     * of points in SIMD lanes, such as perlin_noise_generator, evaluates up to 8 octaves side by
+     * side. The weighted sum is taken in the same order as in at(p), so the result is identical.
+     *
+     *          This lowers the latency of single point queries that can't be batched across points,
+     * especially in higher dimensions and with many octaves. For few octaves in low dimensions,
+     * unused lanes can make at(p) faster.
+     *
+     * @param p Point of evaluation
+     * @return  Noise function value at the specified point
+     */
+    result_t at_packed(point<result_t, dimensions> const& p) const
+    {
+        static_assert(has_batch_at_v<Gen>, "Generator must evaluate ranges of points at once");
+
+        // The octaves are evaluated side by side, so they can't be timed one by one
+        Instrumentation::count(counter::samples);
+        Instrumentation::count(counter::octaves, Octaves);
+
+        std::array<point<result_t, dimensions>, Octaves> octavePoints;
+        for (int i = 0; i < Octaves; ++i)
+            octavePoints[i] = pointAtOctave(p, i);
+        std::array<result_t, Octaves> values;
+        m_noiseGen.at(octavePoints.begin(), octavePoints.end(), values.begin());
+
+        result_t result = 0;
+        for (int i = 0; i < Octaves; ++i)
+            result += values[i] * m_weights[i];
+
+        return smoothstep<Contrast>((result + 1) / 2.f) * 2.f - 1;
+    }
+
+    /**
+     * Evaluate the noise function at a point given as lattice cell and offset within the cell.
+     *
+     * @details Requires the underlying generator to provide at(cell, frac). The cell is scaled to
+     * every octave in double precision and split again, so that the offset passed on keeps the
+     * full precision of result_t even far away from the origin. The scaled cells of all octaves
+     * must be representable by grid_coord_t.
+     *
+     * @param cell Integral lattice cell
+     * @param frac Offset within the cell, usually in [0, 1)
+     * @return     Noise function value at the specified point
+     */
+    result_t at(point<grid_coord_t, dimensions> const& cell,
+                point<result_t, dimensions> const& frac) const noexcept
+    {
+        Instrumentation::count(counter::samples);
+
+        result_t result = 0;
+        for (int i = 0; i < Octaves; ++i)
+        {
+            auto const start = Instrumentation::cycles();
+            point<grid_coord_t, dimensions> octaveCell;
+            point<result_t, dimensions> octaveFrac;
+            splitPointAtOctave(cell, frac, i, octaveCell, octaveFrac);
+            result += m_noiseGen.at(octaveCell, octaveFrac) * m_weights[i];
+            Instrumentation::add_octave(i, 1, Instrumentation::cycles() - start);
+        }
+
+        return smoothstep<Contrast>((result + 1) / 2.f) * 2.f - 1;
+    }
+
+    /**
+     * Evaluate the noise function at multiple points.
+     *
+     * @details Evaluates the points octave by octave. If the underlying generator can evaluate
+     * ranges of points at once, every octave is passed to it in one go. The results are identical
+     * to evaluating every point on its own.
+     *
+     * @tparam InputIt  Input iterator over point<result_t, dimensions>
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param first     Begin of the range of evaluation points
+     * @param last      End of the range of evaluation points
+     * @param out       Destination of the noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class InputIt, class OutputIt>
+    OutputIt at(InputIt first, InputIt last, OutputIt out) const
+    {
+        std::vector<point<result_t, dimensions>> const points(first, last);
+        std::vector<point<result_t, dimensions>> octavePoints(points.size());
+        std::vector<result_t> values(points.size());
+        std::vector<result_t> results(points.size(), result_t{0});
+        Instrumentation::count(counter::samples, points.size());
+        for (int i = 0; i < Octaves; ++i)
+        {
+            auto const start = Instrumentation::cycles();
+            std::transform(points.begin(), points.end(), octavePoints.begin(), [&](auto const& p) {
+                return pointAtOctave(p, i);
+            });
+            if constexpr (has_batch_at_v<Gen>)
+            {
+                m_noiseGen.at(octavePoints.data(),
+                              octavePoints.data() + octavePoints.size(),
+                              values.data());
+            }
+            else
+            {
+                std::transform(octavePoints.begin(),
+                               octavePoints.end(),
+                               values.begin(),
+                               [this](auto const& p) { return m_noiseGen.at(p); });
+            }
+            for (std::size_t k = 0; k < results.size(); ++k)
+                results[k] += values[k] * m_weights[i];
+            Instrumentation::add_octave(i, points.size(), Instrumentation::cycles() - start);
+        }
+
+        return std::transform(results.begin(), results.end(), out, [](result_t result) {
+            return smoothstep<Contrast>((result + 1) / 2.f) * 2.f - 1;
+        });
+    }
+
+    /**
+     * Evaluate the noise function on a section of a regular 3d grid, writing to a strided volume.
+     *
+     * @details Writes the value at origin + (first + (i, j, k)) * step to
+     * out[i * strides[0] + j * strides[1] + k * strides[2]], see fill_volume(coords, out, strides).
+     *
+     * @tparam RandomIt Random access iterator accepting result_t
+     * @param origin    Point of the grid at index 0
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param first     Index of the first grid point of the section
+     * @param extents   Number of grid points of the section along each dimension
+     * @param out       Destination of the noise values
+     * @param strides   Distance in elements between adjacent values along each dimension
+     */
+    template<class RandomIt,
+             class G = Gen,
+             typename = std::enable_if_t<has_fill_volume_v<G>>>
+    void fill_volume(point<result_t, dimensions> const& origin,
+                     vector<result_t, dimensions> const& step,
+                     point<int, dimensions> const& first,
+                     point<int, dimensions> const& extents,
+                     RandomIt out,
+                     std::array<std::ptrdiff_t, dimensions> const& strides) const
+    {
+        std::array<std::vector<result_t>, dimensions> coords;
+        for (int d = 0; d < dimensions; ++d)
+        {
+            coords[d].resize(std::max(extents[d], 0));
+            for (int i = 0; i < extents[d]; ++i)
+                coords[d][i] = origin[d] + static_cast<result_t>(first[d] + i) * step[d];
+        }
+        fill_volume(coords, out, strides);
+    }
+
+    /**
+     * Evaluate the noise function on a 3d rectilinear grid, writing to a strided volume.
+     *
+     * @details Requires the underlying generator to provide fill_volume(). The volume is filled
+     * octave by octave, each octave being a rectilinear grid itself. The results are identical to
+     * calling at() on every point.
+     *
+     * @tparam RandomIt Random access iterator accepting result_t
+     * @param coords    Coordinates of the grid lines along each dimension
+     * @param out       Destination of the noise values
+     * @param strides   Distance in elements between adjacent values along each dimension
+     */
+    template<class RandomIt,
+             class G = Gen,
+             typename = std::enable_if_t<has_fill_volume_v<G>>>
+    void fill_volume(std::array<std::vector<result_t>, dimensions> const& coords,
+                     RandomIt out,
+                     std::array<std::ptrdiff_t, dimensions> const& strides) const
+    {
+        static_assert(dimensions == 3, "Volumes can only be filled by 3D generators");
+
+        std::array<std::ptrdiff_t, dimensions> const denseStrides{
+            1,
+            static_cast<std::ptrdiff_t>(coords[0].size()),
+            static_cast<std::ptrdiff_t>(coords[0].size() * coords[1].size())};
+        std::vector<result_t> values(coords[0].size() * coords[1].size() * coords[2].size());
+        std::vector<result_t> results(values.size(), result_t{0});
+        if (results.empty())
+            return;
+
+        Instrumentation::count(counter::grids);
+        Instrumentation::count(counter::samples, results.size());
+
+        std::array<std::vector<result_t>, dimensions> octaveCoords = coords;
+        for (int i = 0; i < Octaves; ++i)
+        {
+            auto const start = Instrumentation::cycles();
+            for (int d = 0; d < dimensions; ++d)
+            {
+                std::transform(coords[d].begin(),
+                               coords[d].end(),
+                               octaveCoords[d].begin(),
+                               [this, i](result_t c) { return c * m_frequencies[i]; });
+            }
+            m_noiseGen.fill_volume(octaveCoords, values.begin(), denseStrides);
+            for (std::size_t k = 0; k < results.size(); ++k)
+                results[k] += values[k] * m_weights[i];
+            Instrumentation::add_octave(i, results.size(), Instrumentation::cycles() - start);
+        }
+
+        auto result = results.begin();
+        for (std::size_t k = 0; k < coords[2].size(); ++k)
+        {
+            for (std::size_t j = 0; j < coords[1].size(); ++j)
+            {
+                auto const rowOut = out
+                                    + (static_cast<std::ptrdiff_t>(k) * strides[2]
+                                       + static_cast<std::ptrdiff_t>(j) * strides[1]);
+                for (std::size_t i = 0; i < coords[0].size(); ++i, ++result)
+                {
+                    rowOut[static_cast<std::ptrdiff_t>(i) * strides[0]]
+                        = smoothstep<Contrast>((*result + 1) / 2.f) * 2.f - 1;
+                }
+            }
+        }
+    }
+
+    /**
+     * Evaluate the noise function at a given point, omitting details below a sampling footprint.
+     *
+     * @details Octaves whose features are too small to be resolved at the given footprint are
+     * faded out and skipped: An octave of frequency f contributes fully as long as f * footprint
+     * is at most 1/4 and is skipped from 1/2 on, where it would only cause aliasing. Furthermore,
+     * evaluation stops as soon as the total weight of all remaining octaves falls below the
+     * tolerance, e.g. 1/255 if the result is quantized to 8 bits.
+     *
+     *          With a footprint and tolerance of 0, the result is identical to at(p).
+     *
+     * @param p         Point of evaluation
+     * @param footprint Distance between adjacent samples, e.g. the size of a pixel
+     * @param tolerance Weight of octaves that may be dropped
+     * @return          Noise function value at the specified point
+     */
+    result_t at(point<result_t, dimensions> const& p,
+                result_t footprint,
+                result_t tolerance = 0) const noexcept
+    {
+        Instrumentation::count(counter::samples);
+
+        result_t result = 0;
+        int evaluated = 0;
+        for (int i = 0; i < Octaves && m_remainingWeights[i] >= tolerance; ++i)
+        {
+            auto const lodWeight = octave_lod_weight(i, footprint);
+            if (lodWeight > 0)
+            {
+                auto const start = Instrumentation::cycles();
+                result += m_noiseGen.at(pointAtOctave(p, i)) * (m_weights[i] * lodWeight);
+                Instrumentation::add_octave(i, 1, Instrumentation::cycles() - start);
+                ++evaluated;
+            }
+        }
+        Instrumentation::count(counter::skipped_octaves, Octaves - evaluated);
 
         return smoothstep<Contrast>((result + 1) / 2.f) * 2.f - 1;
     }
 
+    /**
+     * Evaluate the noise function and its gradient at a given point.
+     *
+     * @details Requires the underlying generator to provide at_with_gradient(). The gradients of
+     * the octaves are scaled by their weight and frequency and chained through the final contrast
+     * adjustment.
+     *
+     * @param p Point of evaluation
+     * @return  Noise function value and its partial derivatives at the specified point
+     */
+    value_and_gradient<result_t, dimensions> at_with_gradient(
+        point<result_t, dimensions> const& p) const noexcept
+    {
+        Instrumentation::count(counter::samples);
+
+        result_t result = 0;
+        vector<result_t, dimensions> gradient{};
+        for (int i = 0; i < Octaves; ++i)
+        {
+            auto const start = Instrumentation::cycles();
+            auto const octave = m_noiseGen.at_with_gradient(pointAtOctave(p, i));
+            result += octave.value * m_weights[i];
+            gradient += octave.gradient * (m_weights[i] * m_frequencies[i]);
+            Instrumentation::add_octave(i, 1, Instrumentation::cycles() - start);
+        }
+
+        gradient *= smoothstep_derivative<Contrast>((result + 1) / 2.f);
+        return {smoothstep<Contrast>((result + 1) / 2.f) * 2.f - 1, gradient};
+    }
+
   private:
+    /**
+     * @param octave    Octave index
+     * @param footprint Distance between adjacent samples
+     * @return          Factor in [0,1] to fade out the octave before it aliases
+     */
+    constexpr result_t octave_lod_weight(int octave, result_t footprint) const noexcept
+    {
+        auto const cellsPerSample = std::abs(m_frequencies[octave]) * footprint;
+        return smoothstep<0>((result_t(0.5) - cellsPerSample) * 4);
+    }
+
     constexpr point<result_t, dimensions> pointAtOctave(point<result_t, dimensions> p,
                                                         int octave) const noexcept
     {
@@ -150,9 +472,30 @@ class fractal_noise_generator
         return p;
     }
 
+    void splitPointAtOctave(point<grid_coord_t, dimensions> const& cell,
+                            point<result_t, dimensions> const& frac,
+                            int octave,
+                            point<grid_coord_t, dimensions>& octaveCell,
+                            point<result_t, dimensions>& octaveFrac) const noexcept
+    {
+        auto const frequency = static_cast<double>(m_frequencies[octave]);
+        for (int d = 0; d < dimensions; ++d)
+        {
+            // Non-integral frequencies move part of the scaled cell into the offset
+            auto const scaledCell = static_cast<double>(cell[d]) * frequency;
+            auto const scaledCellFloor = std::floor(scaledCell);
+            auto const scaledFrac
+                = (scaledCell - scaledCellFloor) + static_cast<double>(frac[d]) * frequency;
+            auto const scaledFracFloor = std::floor(scaledFrac);
+            octaveCell[d] = static_cast<grid_coord_t>(scaledCellFloor + scaledFracFloor);
+            octaveFrac[d] = static_cast<result_t>(scaledFrac - scaledFracFloor);
+        }
+    }
+
     Gen m_noiseGen;
     std::array<result_t, Octaves> m_weights;
     std::array<result_t, Octaves> m_frequencies;
+    std::array<result_t, Octaves> m_remainingWeights; // Sum of absolute weights from octave i on
 };
 
 } // namespace noise
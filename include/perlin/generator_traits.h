@@ -0,0 +1,119 @@
+/**********************************************************
+ * @file   generator_traits.h
+ * @author jan
+ * @date   7/23/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_GENERATOR_TRAITS_H
+#define PERLINNOISE_GENERATOR_TRAITS_H
+
+#include "perlin/point.h"
+#include "perlin/vector.h"
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace noise
+{
+/**
+ * Checks whether a generator provides fill_grid() to evaluate sections of regular grids
+ * @tparam Gen Noise generator
+ */
+template<class Gen, class = void>
+struct has_fill_grid : std::false_type
+{
+};
+
+template<class Gen>
+struct has_fill_grid<
+    Gen,
+    std::void_t<decltype(std::declval<Gen const&>().fill_grid(
+        std::declval<point<typename Gen::result_t, Gen::dimensions>>(),
+        std::declval<vector<typename Gen::result_t, Gen::dimensions>>(),
+        std::declval<point<int, Gen::dimensions>>(),
+        std::declval<point<int, Gen::dimensions>>(),
+        std::declval<typename Gen::result_t*>()))>> : std::true_type
+{
+};
+
+template<class Gen>
+constexpr bool const has_fill_grid_v = has_fill_grid<Gen>::value;
+
+/**
+ * Checks whether a 3d generator provides fill_volume() to evaluate sections of regular grids into
+ * strided volumes
+ * @tparam Gen Noise generator
+ */
+template<class Gen, class = void>
+struct has_fill_volume : std::false_type
+{
+};
+
+template<class Gen>
+struct has_fill_volume<
+    Gen,
+    std::void_t<decltype(std::declval<Gen const&>().fill_volume(
+        std::declval<point<typename Gen::result_t, Gen::dimensions>>(),
+        std::declval<vector<typename Gen::result_t, Gen::dimensions>>(),
+        std::declval<point<int, Gen::dimensions>>(),
+        std::declval<point<int, Gen::dimensions>>(),
+        std::declval<typename Gen::result_t*>(),
+        std::declval<std::array<std::ptrdiff_t, Gen::dimensions>>()))>>
+    : std::bool_constant<Gen::dimensions == 3>
+{
+};
+
+template<class Gen>
+constexpr bool const has_fill_volume_v = has_fill_volume<Gen>::value;
+
+/**
+ * Checks whether a generator provides an at() overload evaluating a range of points at once
+ * @tparam Gen Noise generator
+ */
+template<class Gen, class = void>
+struct has_batch_at : std::false_type
+{
+};
+
+template<class Gen>
+struct has_batch_at<
+    Gen,
+    std::void_t<decltype(std::declval<Gen const&>().at(
+        std::declval<point<typename Gen::result_t, Gen::dimensions> const*>(),
+        std::declval<point<typename Gen::result_t, Gen::dimensions> const*>(),
+        std::declval<typename Gen::result_t*>()))>> : std::true_type
+{
+};
+
+template<class Gen>
+constexpr bool const has_batch_at_v = has_batch_at<Gen>::value;
+
+/**
+ * Checks whether a generator provides an at() overload omitting details below a sampling footprint
+ * @tparam Gen Noise generator
+ */
+template<class Gen, class = void>
+struct has_footprint_at : std::false_type
+{
+};
+
+template<class Gen>
+struct has_footprint_at<
+    Gen,
+    std::void_t<decltype(std::declval<Gen const&>().at(
+        std::declval<point<typename Gen::result_t, Gen::dimensions>>(),
+        std::declval<typename Gen::result_t>(),
+        std::declval<typename Gen::result_t>()))>> : std::true_type
+{
+};
+
+template<class Gen>
+constexpr bool const has_footprint_at_v = has_footprint_at<Gen>::value;
+
+} // namespace noise
+
+#endif // PERLINNOISE_GENERATOR_TRAITS_H
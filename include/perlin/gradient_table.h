@@ -0,0 +1,329 @@
+/**********************************************************
+ * @file   gradient_table.h
+ * @author jan
+ * @date   7/22/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_GRADIENT_TABLE_H
+#define PERLINNOISE_GRADIENT_TABLE_H
+
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/random.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <type_traits>
+
+namespace noise
+{
+/**
+ * Read-only view of the arrays of a gradient table, e.g. within a memory-mapped file
+ *
+ * @tparam Permutation Integral type of the permutation table
+ * @tparam Result      Floating point type of the gradient components
+ */
+template<typename Permutation, typename Result>
+struct gradient_table_view
+{
+    Permutation const* permutations; // num_permutations entries
+    Result const* gradients;         // size * dimensions components, one gradient after another
+};
+
+/**
+ * Layout of a permutation table hashing grid points into one of NumGradients gradients.
+ *
+ * @details If NumGradients is a power of two, the permutations are stored twice in a row. Hashing
+ * then never needs to wrap around sums of permutations and masked coordinates.
+ *
+ * @tparam NumGradients Amount of gradients
+ */
+template<int NumGradients>
+struct permutation_table_traits
+{
+    static_assert(NumGradients > 0, "Must allow at least one pre-computed gradient");
+
+    using permutation_t = std::conditional_t<
+        (NumGradients <= 256),
+        std::uint8_t,
+        std::conditional_t<(NumGradients <= 65536), std::uint16_t, int>>;
+
+    static constexpr const bool is_power_of_two = (NumGradients & (NumGradients - 1)) == 0;
+    static constexpr const int size = is_power_of_two ? 2 * NumGradients : NumGradients;
+};
+
+/**
+ * Fill a permutation table with a random permutation in a constant expression.
+ *
+ * @details Fisher-Yates shuffle drawing from a splitmix64 engine, so the permutation is the same
+ * on every platform and at compile time. The permutation is repeated as the layout requires.
+ *
+ * @tparam NumGradients Amount of gradients
+ * @tparam Permutations Random access range of permutation_table_traits<NumGradients>::size
+ * entries
+ * @param permutations  Permutation table to fill
+ * @param rnd           Random engine to draw the permutation from
+ */
+template<int NumGradients, class Permutations>
+constexpr void shuffle_permutations(Permutations& permutations, splitmix64& rnd) noexcept
+{
+    using traits = permutation_table_traits<NumGradients>;
+    using permutation_t = typename traits::permutation_t;
+
+    for (int i = 0; i < NumGradients; ++i)
+        permutations[i] = static_cast<permutation_t>(i);
+    for (int i = NumGradients - 1; i > 0; --i)
+    {
+        auto const j = static_cast<int>(constexpr_uniform_int(rnd, i + 1));
+        auto const tmp = permutations[i];
+        permutations[i] = permutations[j];
+        permutations[j] = tmp;
+    }
+    for (int i = NumGradients; i < traits::size; ++i)
+        permutations[i] = permutations[i - NumGradients];
+}
+
+/**
+ * Reduce a grid coordinate to the range of the permutation table, the first step of hashing it.
+ *
+ * @tparam NumGradients Amount of gradients
+ * @param coord         Grid coordinate
+ * @return              Coordinate in [0, NumGradients)
+ */
+template<int NumGradients, typename GridCoord>
+constexpr GridCoord reduce_grid_coord(GridCoord coord) noexcept
+{
+    if constexpr (permutation_table_traits<NumGradients>::is_power_of_two)
+        return coord & static_cast<GridCoord>(NumGradients - 1);
+    else
+        return mod(coord, static_cast<GridCoord>(NumGradients));
+}
+
+/**
+ * Hash a grid point into the index of its gradient.
+ *
+ * @details The coordinates are mixed in from the last to the first dimension, each added to the
+ * permutation of the hash of the following ones.
+ *
+ * @tparam NumGradients Amount of gradients
+ * @tparam Permutations Random access range laid out as permutation_table_traits describes, e.g.
+ * an array or a pointer
+ * @param permutations  Permutation table
+ * @param point         Grid point
+ * @return              Index of the gradient in [0, NumGradients)
+ */
+template<int NumGradients, class Permutations, typename GridCoord, int Dim>
+constexpr GridCoord gradient_index(Permutations const& permutations,
+                                   point<GridCoord, Dim> const& point) noexcept
+{
+    if constexpr (permutation_table_traits<NumGradients>::is_power_of_two)
+    {
+        constexpr auto const mask = static_cast<GridCoord>(NumGradients - 1);
+        GridCoord idx = point[Dim - 1] & mask;
+        for (int i = Dim - 2; i >= 0; --i)
+            idx = (point[i] & mask) + permutations[idx];
+        return idx & mask;
+    }
+    else
+    {
+        constexpr auto const numGradients = static_cast<GridCoord>(NumGradients);
+        GridCoord idx = mod(point[Dim - 1], numGradients);
+        for (int i = Dim - 2; i >= 0; --i)
+            idx = mod(static_cast<GridCoord>(point[i] + permutations[idx]), numGradients);
+        return idx;
+    }
+}
+
+/**
+ * Hash a corner of the lattice cells of a pack of points into gradient indices, lane by lane.
+ *
+ * @details Gives the same indices as gradient_index() on every corner. The cells are reduced
+ * beforehand, so that only sums of reduced coordinates and permutations need to wrap around, which
+ * takes a comparison instead of a division.
+ *
+ * @tparam NumGradients Amount of gradients
+ * @tparam Permutations Random access range laid out as permutation_table_traits describes
+ * @param permutations  Permutation table
+ * @param reducedCells  Lowest corners of the cells, reduced by reduce_grid_coord(), one lane per
+ * point
+ * @param corner        Corner, offset by one along every dimension d where bit d is set
+ * @param indices       Indices of the gradients at the corners, one lane per point
+ */
+template<int NumGradients, class Permutations, typename GridCoord, std::size_t Dim, std::size_t N>
+constexpr void gradient_indices(Permutations const& permutations,
+                                std::array<std::array<GridCoord, N>, Dim> const& reducedCells,
+                                int corner,
+                                std::array<GridCoord, N>& indices) noexcept
+{
+    constexpr bool const isPowerOfTwo = permutation_table_traits<NumGradients>::is_power_of_two;
+    constexpr auto const numGradients = static_cast<GridCoord>(NumGradients);
+    auto wrap = [](GridCoord i) {
+        // The doubled permutation table makes wrapping unnecessary
+        if constexpr (isPowerOfTwo)
+            return i;
+        else
+            return i >= numGradients ? static_cast<GridCoord>(i - numGradients) : i;
+    };
+
+    constexpr int const last = static_cast<int>(Dim) - 1;
+    for (std::size_t l = 0; l < N; ++l)
+        indices[l] = wrap(reducedCells[last][l] + ((corner >> last) & 1));
+    for (int d = last - 1; d >= 0; --d)
+    {
+        for (std::size_t l = 0; l < N; ++l)
+        {
+            indices[l]
+                = wrap(reducedCells[d][l] + ((corner >> d) & 1) + permutations[indices[l]]);
+        }
+    }
+    if constexpr (isPowerOfTwo)
+    {
+        for (std::size_t l = 0; l < N; ++l)
+            indices[l] &= numGradients - 1;
+    }
+}
+
+/**
+ * Pseudo-random assignment of gradients to grid points.
+ *
+ * @details Grid points are hashed into one of NumGradients random unit vectors through a random
+ * permutation table, see gradient_index().
+ *
+ * @tparam Dim          Dimensionality of the grid
+ * @tparam Result       Floating point type of the gradients
+ * @tparam NumGradients Amount of random gradients to use
+ * @tparam GridCoord    Integral grid coordinate type
+ */
+template<int Dim, typename Result = float, int NumGradients = 256, typename GridCoord = int>
+class gradient_table
+{
+  public:
+    static_assert(Dim > 0, "Must have at least one dimension");
+    static_assert(NumGradients > 0, "Must allow at least one pre-computed gradient");
+    static_assert(std::is_integral_v<GridCoord>, "GridCoord must be an integral type");
+
+    using result_t = Result;
+    using grid_coord_t = GridCoord;
+    using permutation_t = typename permutation_table_traits<NumGradients>::permutation_t;
+    using view_t = gradient_table_view<permutation_t, result_t>;
+
+    static constexpr const int dimensions = Dim;
+    static constexpr const int size = NumGradients;
+    static constexpr const bool is_power_of_two
+        = permutation_table_traits<NumGradients>::is_power_of_two;
+    static constexpr const int num_permutations = permutation_table_traits<NumGradients>::size;
+    static constexpr const grid_coord_t mask = NumGradients - 1;
+    static constexpr const bool is_hashed = false;
+
+    /**
+     * @param seed Random seed for gradient generation
+     */
+    template<class RndEngine = std::default_random_engine,
+             typename = std::enable_if_t<!std::is_same_v<std::decay_t<RndEngine>, view_t>>>
+    explicit gradient_table(RndEngine&& rnd) noexcept
+    {
+        auto const permutationsEnd = m_permutations.begin() + NumGradients;
+        std::iota(m_permutations.begin(), permutationsEnd, permutation_t{0});
+        std::shuffle(m_permutations.begin(), permutationsEnd, std::forward<RndEngine>(rnd));
+        std::copy(m_permutations.begin(), permutationsEnd, permutationsEnd);
+        std::generate(m_gradients.begin(), m_gradients.end(), [&]() {
+            return vector<result_t, Dim>::make_rand_unit_vec(std::forward<RndEngine>(rnd));
+        });
+    }
+
+    /**
+     * Generate the table in a constant expression, e.g. to bake it into read-only data.
+     *
+     * @details Uses its own shuffle and gradient sampling, so the table differs from the one
+     * generated by a standard engine. It is the same whether it is generated at compile time or at
+     * run time.
+     *
+     * @param rnd Random engine for gradient generation
+     */
+    constexpr explicit gradient_table(splitmix64& rnd) noexcept
+    {
+        shuffle_permutations<NumGradients>(m_permutations, rnd);
+
+        // Uniformly distributed directions by rejection sampling from the unit ball
+        for (auto& gradient : m_gradients)
+        {
+            result_t sqMag = 0;
+            do
+            {
+                for (int d = 0; d < Dim; ++d)
+                    gradient[d] = constexpr_uniform_real(rnd, result_t{-1}, result_t{1});
+                sqMag = sq_magnitude(gradient);
+            } while (sqMag > result_t{1} || sqMag == result_t{0});
+
+            auto const mag = constexpr_sqrt(sqMag);
+            for (int d = 0; d < Dim; ++d)
+                gradient[d] = gradient[d] / mag;
+        }
+    }
+
+    /**
+     * @param rnd Random engine for gradient generation
+     */
+    constexpr explicit gradient_table(splitmix64&& rnd) noexcept
+        : gradient_table(rnd)
+    {
+    }
+
+    /**
+     * Copy the table from another one, e.g. loaded from a gradient_table_file
+     * @param view Arrays of a table with the same parameters
+     */
+    explicit gradient_table(view_t const& view) noexcept
+    {
+        std::copy_n(view.permutations, num_permutations, m_permutations.begin());
+        for (int i = 0; i < NumGradients; ++i)
+            std::copy_n(view.gradients + i * Dim, Dim, m_gradients[i].begin());
+    }
+
+    /**
+     * @param point Grid point
+     * @return      Gradient assigned to the grid point
+     */
+    constexpr vector<result_t, Dim> const& at(point<grid_coord_t, Dim> const& point) const noexcept
+    {
+        return m_gradients[gradient_index<NumGradients>(m_permutations, point)];
+    }
+
+    /**
+     * @param idx Index in [0, size), or in [0, 2 * size) if size is a power of two
+     * @return    Permutation of the index
+     */
+    constexpr grid_coord_t permutation(grid_coord_t idx) const noexcept
+    {
+        return m_permutations[idx];
+    }
+
+    /**
+     * @return Permutation table of num_permutations entries, see gradient_index()
+     */
+    constexpr permutation_t const* permutations() const noexcept { return m_permutations.data(); }
+
+    /**
+     * @param idx Index in [0, size)
+     * @return    Gradient with that index
+     */
+    constexpr vector<result_t, Dim> const& gradient(grid_coord_t idx) const noexcept
+    {
+        return m_gradients[idx];
+    }
+
+  private:
+    std::array<permutation_t, num_permutations> m_permutations{};
+    std::array<vector<result_t, Dim>, NumGradients> m_gradients{};
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_GRADIENT_TABLE_H
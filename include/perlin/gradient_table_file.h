@@ -0,0 +1,443 @@
+/**********************************************************
+ * @file   gradient_table_file.h
+ * @author jan
+ * @date   8/2/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_GRADIENT_TABLE_FILE_H
+#define PERLINNOISE_GRADIENT_TABLE_FILE_H
+
+#include "perlin/gradient_table.h"
+#include "perlin/math.h"
+#include "perlin/perlin_noise_generator.h"
+#include "perlin/point.h"
+#include "perlin/vector.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#define PERLINNOISE_UNDEF_NOMINMAX
+#endif
+#include <windows.h>
+#ifdef PERLINNOISE_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef PERLINNOISE_UNDEF_NOMINMAX
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace noise
+{
+/**
+ * Header of a gradient table file.
+ *
+ * @details A file consists of the header, the permutation table and the gradient components, in
+ * the byte order of the machine that saved it. Both arrays start at a multiple of 64 bytes, so
+ * they can be used in place once the file is mapped into memory.
+ */
+struct gradient_table_header
+{
+    static constexpr std::array<char, 8> const magic_value
+        = {'P', 'E', 'R', 'L', 'I', 'N', 'G', 'T'};
+    static constexpr std::uint32_t const current_version = 1;
+    static constexpr std::uint32_t const byte_order_mark = 0x01020304;
+
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t byte_order;       // byte_order_mark in the byte order of the saving machine
+    std::uint32_t dimensions;
+    std::uint32_t num_gradients;
+    std::uint32_t result_size;      // Size of a gradient component in bytes
+    std::uint32_t permutation_size; // Size of a permutation table entry in bytes
+    std::uint64_t num_permutations;
+    std::uint64_t permutations_offset;
+    std::uint64_t gradients_offset;
+    std::uint64_t file_size;
+
+    /**
+     * @tparam Table gradient_table or mapped_gradient_table
+     * @return       Header of a file holding a table of that type
+     */
+    template<class Table>
+    static constexpr gradient_table_header make() noexcept
+    {
+        gradient_table_header header{};
+        header.magic = magic_value;
+        header.version = current_version;
+        header.byte_order = byte_order_mark;
+        header.dimensions = Table::dimensions;
+        header.num_gradients = Table::size;
+        header.result_size = sizeof(typename Table::result_t);
+        header.permutation_size = sizeof(typename Table::permutation_t);
+        header.num_permutations = Table::num_permutations;
+        header.permutations_offset = align(sizeof(gradient_table_header));
+        header.gradients_offset = align(header.permutations_offset
+                                        + header.num_permutations * header.permutation_size);
+        header.file_size = header.gradients_offset
+                           + std::uint64_t{Table::size} * Table::dimensions * header.result_size;
+        return header;
+    }
+
+    /**
+     * @param other Another header
+     * @return      Whether both headers describe the same layout
+     */
+    bool operator==(gradient_table_header const& other) const noexcept
+    {
+        return magic == other.magic && version == other.version && byte_order == other.byte_order
+               && dimensions == other.dimensions && num_gradients == other.num_gradients
+               && result_size == other.result_size && permutation_size == other.permutation_size
+               && num_permutations == other.num_permutations
+               && permutations_offset == other.permutations_offset
+               && gradients_offset == other.gradients_offset && file_size == other.file_size;
+    }
+
+    bool operator!=(gradient_table_header const& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+  private:
+    static constexpr std::uint64_t align(std::uint64_t offset) noexcept
+    {
+        return (offset + 63) / 64 * 64;
+    }
+};
+
+/**
+ * Save a gradient table to a file.
+ *
+ * @tparam Table gradient_table or mapped_gradient_table
+ * @param table  Table to save, e.g. perlin_noise_generator::gradients()
+ * @param path   Path of the file, which is overwritten if it exists
+ * @return       Whether the file was written successfully
+ */
+template<class Table>
+bool save_gradient_table(Table const& table, std::string const& path)
+{
+    using permutation_t = typename Table::permutation_t;
+    using result_t = typename Table::result_t;
+
+    auto const header = gradient_table_header::make<Table>();
+    std::vector<char> bytes(header.file_size, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    for (std::size_t i = 0; i < header.num_permutations; ++i)
+    {
+        auto const p = static_cast<permutation_t>(table.permutation(static_cast<int>(i)));
+        std::memcpy(bytes.data() + header.permutations_offset + i * sizeof(p), &p, sizeof(p));
+    }
+    for (int i = 0; i < Table::size; ++i)
+    {
+        vector<result_t, Table::dimensions> const gradient = table.gradient(i);
+        std::memcpy(bytes.data() + header.gradients_offset
+                        + static_cast<std::size_t>(i) * Table::dimensions * sizeof(result_t),
+                    &gradient[0],
+                    Table::dimensions * sizeof(result_t));
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file.flush());
+}
+
+/**
+ * Gradient table type of a generator, or the type itself if it is no generator
+ * @tparam Gen perlin_noise_generator or gradient table
+ */
+template<class Gen, class = void>
+struct gradient_table_of
+{
+    using type = Gen;
+};
+
+template<class Gen>
+struct gradient_table_of<Gen, std::void_t<typename Gen::gradients_t>>
+{
+    using type = typename Gen::gradients_t;
+};
+
+template<class Gen>
+using gradient_table_of_t = typename gradient_table_of<Gen>::type;
+
+/**
+ * A gradient table file mapped read-only into memory.
+ *
+ * @details Pages are loaded on first access and shared by all processes mapping the same file, so
+ * many processes using the same large table hold a single physical copy of it. Mapping a file
+ * doesn't read it, so opening takes the same time regardless of the table size.
+ *
+ *          The file must not be modified while it is mapped.
+ */
+class gradient_table_file
+{
+  public:
+    gradient_table_file() noexcept = default;
+
+    /**
+     * Map a file saved by save_gradient_table()
+     *
+     * @details If the file can't be mapped or isn't a gradient table file of the current version
+     * saved on a machine with the same byte order, is_open() returns false.
+     *
+     * @param path Path of the file
+     */
+    explicit gradient_table_file(std::string const& path) noexcept
+    {
+        map(path);
+        if (m_size < sizeof(gradient_table_header))
+        {
+            unmap();
+            return;
+        }
+
+        // Later versions may change the layout of the header after the version
+        auto const& h = header();
+        if (h.magic != gradient_table_header::magic_value
+            || h.version != gradient_table_header::current_version)
+            unmap();
+        else if (h.byte_order != gradient_table_header::byte_order_mark || h.file_size > m_size)
+            unmap();
+    }
+
+    gradient_table_file(gradient_table_file&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr))
+        , m_size(std::exchange(other.m_size, 0))
+    {
+    }
+
+    gradient_table_file& operator=(gradient_table_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    gradient_table_file(gradient_table_file const&) = delete;
+    gradient_table_file& operator=(gradient_table_file const&) = delete;
+
+    ~gradient_table_file() noexcept { unmap(); }
+
+    /**
+     * @return Whether a valid gradient table file is mapped
+     */
+    bool is_open() const noexcept { return m_data != nullptr; }
+
+    /**
+     * @return Header of the file. Requires is_open().
+     */
+    gradient_table_header const& header() const noexcept
+    {
+        return *static_cast<gradient_table_header const*>(m_data);
+    }
+
+    /**
+     * @tparam Gen perlin_noise_generator, or its gradient table type
+     * @return     Whether the file holds a table that the generator can use
+     */
+    template<class Gen>
+    bool holds() const noexcept
+    {
+        return is_open() && header() == gradient_table_header::make<gradient_table_of_t<Gen>>();
+    }
+
+    /**
+     * @tparam Gen perlin_noise_generator, or its gradient table type
+     * @return     Arrays of the table within the mapped file, to construct a generator from.
+     *             Requires holds<Gen>(), and the file to stay mapped while they are used.
+     */
+    template<class Gen>
+    typename gradient_table_of_t<Gen>::view_t view() const noexcept
+    {
+        using table = gradient_table_of_t<Gen>;
+        auto const bytes = static_cast<char const*>(m_data);
+        auto const& h = header();
+        return {reinterpret_cast<typename table::permutation_t const*>(bytes
+                                                                        + h.permutations_offset),
+                reinterpret_cast<typename table::result_t const*>(bytes + h.gradients_offset)};
+    }
+
+  private:
+    void const* m_data = nullptr;
+    std::size_t m_size = 0;
+
+#if defined(_WIN32)
+    void map(std::string const& path) noexcept
+    {
+        HANDLE const file = CreateFileA(path.c_str(),
+                                        GENERIC_READ,
+                                        FILE_SHARE_READ,
+                                        nullptr,
+                                        OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL,
+                                        nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            HANDLE const mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr)
+            {
+                m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (m_data != nullptr)
+                    m_size = static_cast<std::size_t>(size.QuadPart);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+
+    void unmap() noexcept
+    {
+        if (m_data != nullptr)
+            UnmapViewOfFile(m_data);
+        m_data = nullptr;
+        m_size = 0;
+    }
+#else
+    void map(std::string const& path) noexcept
+    {
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            auto const size = static_cast<std::size_t>(info.st_size);
+            void* const data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                m_data = data;
+                m_size = size;
+            }
+        }
+        ::close(fd);
+    }
+
+    void unmap() noexcept
+    {
+        if (m_data != nullptr)
+            ::munmap(const_cast<void*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+};
+
+/**
+ * Pseudo-random assignment of gradients to grid points, using the arrays of a memory-mapped file.
+ *
+ * @details Drop-in replacement for gradient_table that refers to the arrays of a table saved with
+ * save_gradient_table() instead of owning them. It only holds two pointers. Grid points are hashed
+ * by the same gradient_index() as in gradient_table, so the noise is identical to the one of the
+ * saved table. See mapped_perlin_noise_generator.
+ *
+ * @tparam Dim          Dimensionality of the grid
+ * @tparam Result       Floating point type of the gradients
+ * @tparam NumGradients Amount of random gradients to use
+ * @tparam GridCoord    Integral grid coordinate type
+ */
+template<int Dim, typename Result = float, int NumGradients = 256, typename GridCoord = int>
+class mapped_gradient_table
+{
+  public:
+    using owning_t = gradient_table<Dim, Result, NumGradients, GridCoord>;
+
+    using result_t = Result;
+    using grid_coord_t = GridCoord;
+    using permutation_t = typename owning_t::permutation_t;
+    using view_t = typename owning_t::view_t;
+
+    static constexpr const int dimensions = Dim;
+    static constexpr const int size = NumGradients;
+    static constexpr const bool is_power_of_two = owning_t::is_power_of_two;
+    static constexpr const int num_permutations = owning_t::num_permutations;
+    static constexpr const grid_coord_t mask = owning_t::mask;
+    static constexpr const bool is_hashed = false;
+
+    /**
+     * @param view Arrays of a table with the same parameters, e.g. gradient_table_file::view().
+     *             They must stay valid as long as the table is used.
+     */
+    explicit mapped_gradient_table(view_t const& view) noexcept
+        : m_view(view)
+    {
+    }
+
+    /**
+     * @param point Grid point
+     * @return      Gradient assigned to the grid point
+     */
+    vector<result_t, Dim> at(point<grid_coord_t, Dim> const& point) const noexcept
+    {
+        return gradient(gradient_index<NumGradients>(m_view.permutations, point));
+    }
+
+    /**
+     * @param idx Index in [0, size), or in [0, 2 * size) if size is a power of two
+     * @return    Permutation of the index
+     */
+    grid_coord_t permutation(grid_coord_t idx) const noexcept { return m_view.permutations[idx]; }
+
+    /**
+     * @return Permutation table of num_permutations entries, see gradient_index()
+     */
+    permutation_t const* permutations() const noexcept { return m_view.permutations; }
+
+    /**
+     * @param idx Index in [0, size)
+     * @return    Gradient with that index
+     */
+    vector<result_t, Dim> gradient(grid_coord_t idx) const noexcept
+    {
+        vector<result_t, Dim> gradient;
+        auto const components = m_view.gradients + static_cast<std::ptrdiff_t>(idx) * Dim;
+        for (int d = 0; d < Dim; ++d)
+            gradient[d] = components[d];
+        return gradient;
+    }
+
+  private:
+    view_t m_view;
+};
+
+/**
+ * Perlin noise generator using the gradient table of a memory-mapped file, see gradient_table_file
+ */
+template<int Dim,
+         int Smoothness = 2,
+         typename Result = float,
+         int NumGradients = 256,
+         typename GridCoord = int>
+using mapped_perlin_noise_generator = perlin_noise_generator<Dim,
+                                                             Smoothness,
+                                                             Result,
+                                                             NumGradients,
+                                                             GridCoord,
+                                                             mapped_gradient_table>;
+
+} // namespace noise
+
+#endif // PERLINNOISE_GRADIENT_TABLE_FILE_H
@@ -0,0 +1,188 @@
+/**********************************************************
+ * @file   hashed_gradients.h
+ * @author jan
+ * @date   7/29/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_HASHED_GRADIENTS_H
+#define PERLINNOISE_HASHED_GRADIENTS_H
+
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/random.h"
+#include "perlin/vector.h"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+namespace noise
+{
+/**
+ * Table-free pseudo-random assignment of gradients to grid points.
+ *
+ * @details Drop-in replacement for gradient_table that stores nothing but a 32 bit seed. Every
+ * grid point is hashed together with the seed, and the gradient is built from the bits of the hash:
+ *          - In 1d, it is +1 or -1.
+ *          - In 2d, it points to one of the 4 corners of the square, (+-1, +-1).
+ *          - From 3d on, it points to the middle of one of the Dim * 2^(Dim - 1) edges of the
+ *            hypercube, i.e. all components are +-1 except for one which is 0. In 3d, these are
+ *            the 12 gradients of improved Perlin noise.
+ *          All gradients are scaled to unit length, like the ones of gradient_table.
+ *
+ *          Computing a gradient takes a few integer multiplications and no memory access, so the
+ *          gradients of a pack of points can be computed lane by lane in SIMD registers instead of
+ *          being gathered from a table. The noise differs from the one of a gradient_table
+ *          constructed from the same engine.
+ *
+ * @tparam Dim          Dimensionality of the grid
+ * @tparam Result       Floating point type of the gradients
+ * @tparam NumGradients Unused, keeps the parameters interchangeable with gradient_table
+ * @tparam GridCoord    Integral grid coordinate type
+ */
+template<int Dim, typename Result = float, int NumGradients = 256, typename GridCoord = int>
+class hashed_gradients
+{
+  public:
+    static_assert(Dim > 0, "Must have at least one dimension");
+    static_assert(Dim <= 16, "Gradients of more than 16 dimensions can't be built from a hash");
+    static_assert(std::is_integral_v<GridCoord>, "GridCoord must be an integral type");
+
+    using result_t = Result;
+    using grid_coord_t = GridCoord;
+
+    static constexpr const int dimensions = Dim;
+    static constexpr const bool is_hashed = true;
+
+    /**
+     * @param rnd Random engine to draw the seed from
+     */
+    template<class RndEngine = std::default_random_engine>
+    explicit hashed_gradients(RndEngine&& rnd) noexcept
+        : m_seed(std::uniform_int_distribution<std::uint32_t>{}(rnd))
+    {
+    }
+
+    /**
+     * @param rnd Random engine to draw the seed from
+     */
+    constexpr explicit hashed_gradients(splitmix64& rnd) noexcept
+        : m_seed(static_cast<std::uint32_t>(rnd() >> 32))
+    {
+    }
+
+    /**
+     * @param rnd Random engine to draw the seed from
+     */
+    constexpr explicit hashed_gradients(splitmix64&& rnd) noexcept
+        : hashed_gradients(rnd)
+    {
+    }
+
+    /**
+     * @param point Grid point
+     * @return      Gradient assigned to the grid point
+     */
+    constexpr vector<result_t, Dim> at(point<grid_coord_t, Dim> const& point) const noexcept
+    {
+        std::uint32_t h = m_seed;
+        for (int d = 0; d < Dim; ++d)
+            h = combine(h, point[d]);
+        h = finalize(h);
+
+        vector<result_t, Dim> gradient;
+        for (int d = 0; d < Dim; ++d)
+            gradient[d] = component(h, d);
+        return gradient;
+    }
+
+    /**
+     * @return Initial value of every hash
+     */
+    constexpr std::uint32_t seed() const noexcept { return m_seed; }
+
+    /**
+     * Mix the next grid coordinate into a hash (a round of MurmurHash3's 32 bit body)
+     *
+     * @details The hash is scrambled after every coordinate, so coordinates don't contribute
+     * linearly: Combinations such as (3k, k) and (0, 0) don't cancel out, and swapping coordinates
+     * changes the hash.
+     *
+     * @param hash  Hash of the seed and the preceding coordinates
+     * @param coord Grid coordinate along the next dimension
+     * @return      Combined hash
+     */
+    static constexpr std::uint32_t combine(std::uint32_t hash, grid_coord_t coord) noexcept
+    {
+        auto const k = rotl(fold(coord) * 0xcc9e2d51u, 15) * 0x1b873593u;
+        return rotl(hash ^ k, 13) * 5 + 0xe6546b64u;
+    }
+
+    /**
+     * Let every bit of a hash depend on every bit of its input (MurmurHash3's finalizer)
+     *
+     * @param hash Hash of the seed and all coordinates of a grid point
+     * @return     Final hash
+     */
+    static constexpr std::uint32_t finalize(std::uint32_t hash) noexcept
+    {
+        hash = (hash ^ (hash >> 16)) * 0x85ebca6bu;
+        hash = (hash ^ (hash >> 13)) * 0xc2b2ae35u;
+        return hash ^ (hash >> 16);
+    }
+
+    /**
+     * @param hash Final hash of a grid point
+     * @param d    Dimension
+     * @return     Component d of the gradient of the grid point
+     */
+    static constexpr result_t component(std::uint32_t hash, int d) noexcept
+    {
+        // Computed arithmetically, as branches on random bits would mostly be mispredicted
+        auto factor = 1 - static_cast<int>((hash >> d) & 1u) * 2;
+        if constexpr (Dim >= 3)
+        {
+            // The upper half of the hash selects the axis orthogonal to the edge
+            auto const axis = ((hash >> 16) * Dim) >> 16;
+            factor *= static_cast<int>((~(1u << axis) >> d) & 1u);
+        }
+        return static_cast<result_t>(factor) * s_component;
+    }
+
+  private:
+    // Magnitude of the non-zero components of a unit length gradient
+    static constexpr result_t const s_component
+        = result_t{1} / constexpr_sqrt(static_cast<result_t>(Dim >= 3 ? Dim - 1 : Dim));
+
+    std::uint32_t m_seed;
+
+    /**
+     * @param value Value to rotate
+     * @param bits  Number of bits to rotate by, from 1 to 31
+     * @return      Value rotated to the left
+     */
+    static constexpr std::uint32_t rotl(std::uint32_t value, int bits) noexcept
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    /**
+     * @param coord Grid coordinate
+     * @return      Coordinate reduced to 32 bits
+     */
+    static constexpr std::uint32_t fold(grid_coord_t coord) noexcept
+    {
+        auto const bits = static_cast<std::make_unsigned_t<grid_coord_t>>(coord);
+        if constexpr (std::numeric_limits<decltype(bits)>::digits > 32)
+            return static_cast<std::uint32_t>(bits ^ (bits >> 32));
+        else
+            return static_cast<std::uint32_t>(bits);
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_HASHED_GRADIENTS_H
@@ -0,0 +1,294 @@
+/**********************************************************
+ * @file   instrumentation.h
+ * @author jan
+ * @date   7/30/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_INSTRUMENTATION_H
+#define PERLINNOISE_INSTRUMENTATION_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PERLINNOISE_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PERLINNOISE_HAS_RDTSC
+#endif
+
+namespace noise
+{
+/**
+ * Events counted by an instrumentation policy
+ */
+enum class counter : int
+{
+    samples,          // Points evaluated by the generator
+    corners,          // Lattice cell corners whose gradient was dotted with a node vector
+    gradient_lookups, // Gradients looked up in a table or computed from a hash
+    grids,            // Calls evaluating a grid or volume at once, e.g. tiles and chunks
+    octaves,          // Octaves evaluated, once per point
+    skipped_octaves   // Octaves skipped, once per point, as they would alias or not be visible
+};
+
+constexpr int const num_counters = 6;
+
+/**
+ * @param c Counter
+ * @return  Name of the counter in snake case
+ */
+constexpr char const* counter_name(counter c) noexcept
+{
+    constexpr char const* const names[num_counters] = {
+        "samples", "corners", "gradient_lookups", "grids", "octaves", "skipped_octaves"};
+    return names[static_cast<int>(c)];
+}
+
+/**
+ * @return Current value of the CPU's time stamp counter, or a nanosecond clock on CPUs without one
+ */
+inline std::uint64_t read_cycle_counter() noexcept
+{
+#ifdef PERLINNOISE_HAS_RDTSC
+    return __rdtsc();
+#else
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+}
+
+/**
+ * Instrumentation policy that does nothing.
+ *
+ * @details Generators call the policy on their hot paths. All functions are empty constant
+ * expressions, so the calls, and the cycle counter reads around them, compile to nothing.
+ */
+struct no_instrumentation
+{
+    static constexpr bool const enabled = false;
+
+    static constexpr void count(counter, std::uint64_t = 1) noexcept {}
+    static constexpr std::uint64_t cycles() noexcept { return 0; }
+    static constexpr void add_octave(int, std::uint64_t, std::uint64_t) noexcept {}
+};
+
+/**
+ * Aggregated counts of an instrumentation policy
+ */
+struct instrumentation_snapshot
+{
+    static constexpr int const max_octaves = 32;
+
+    std::array<std::uint64_t, num_counters> counters{};
+    std::array<std::uint64_t, max_octaves> octave_samples{}; // Points evaluated per octave
+    std::array<std::uint64_t, max_octaves> octave_cycles{};  // Cycles spent per octave
+
+    /**
+     * @param c Counter
+     * @return  Value of the counter
+     */
+    std::uint64_t operator[](counter c) const noexcept { return counters[static_cast<int>(c)]; }
+
+    /**
+     * @return Number of octaves with recorded samples, i.e. one past the highest such octave
+     */
+    int num_octaves() const noexcept
+    {
+        int n = max_octaves;
+        while (n > 0 && octave_samples[n - 1] == 0)
+            --n;
+        return n;
+    }
+
+    /**
+     * @return Snapshot as a single line JSON object
+     */
+    std::string to_json() const
+    {
+        std::ostringstream out;
+        out << "{";
+        for (int c = 0; c < num_counters; ++c)
+            out << "\"" << counter_name(static_cast<counter>(c)) << "\":" << counters[c] << ",";
+        out << "\"octave_samples\":[";
+        for (int i = 0; i < num_octaves(); ++i)
+            out << (i > 0 ? "," : "") << octave_samples[i];
+        out << "],\"octave_cycles\":[";
+        for (int i = 0; i < num_octaves(); ++i)
+            out << (i > 0 ? "," : "") << octave_cycles[i];
+        out << "]}";
+        return out.str();
+    }
+
+    /**
+     * @param prefix Prefix of the metric names
+     * @return       Snapshot in the Prometheus text exposition format
+     */
+    std::string to_prometheus(std::string const& prefix = "noise") const
+    {
+        std::ostringstream out;
+        for (int c = 0; c < num_counters; ++c)
+        {
+            auto const name = prefix + "_" + counter_name(static_cast<counter>(c)) + "_total";
+            out << "# TYPE " << name << " counter\n" << name << " " << counters[c] << "\n";
+        }
+        for (auto const& metric : {std::make_pair("octave_samples", &octave_samples),
+                                   std::make_pair("octave_cycles", &octave_cycles)})
+        {
+            auto const name = prefix + "_" + metric.first + "_total";
+            out << "# TYPE " << name << " counter\n";
+            for (int i = 0; i < num_octaves(); ++i)
+                out << name << "{octave=\"" << i << "\"} " << (*metric.second)[i] << "\n";
+        }
+        return out.str();
+    }
+};
+
+/**
+ * Instrumentation policy counting events per thread.
+ *
+ * @details Every thread counts into its own counters, so counting doesn't synchronize threads.
+ * snapshot() sums up the counters of all running threads and of all threads that have exited.
+ * Octaves are timed with the CPU's time stamp counter.
+ *
+ *          Counters are shared by all generators with the same policy. Nested generators, e.g. a
+ * perlin_noise_generator within a fractal_noise_generator, count separately if they are given
+ * policies with different tags.
+ *
+ * @tparam Tag Any type, distinguishing independent sets of counters
+ */
+template<class Tag = void>
+class counting_instrumentation
+{
+  public:
+    static constexpr bool const enabled = true;
+    static constexpr int const max_octaves = instrumentation_snapshot::max_octaves;
+
+    /**
+     * @param c Counter to increment
+     * @param n Increment
+     */
+    static void count(counter c, std::uint64_t n = 1) noexcept
+    {
+        increment(local().counters[static_cast<int>(c)], n);
+    }
+
+    /**
+     * @return Current value of the cycle counter
+     */
+    static std::uint64_t cycles() noexcept { return read_cycle_counter(); }
+
+    /**
+     * Record the evaluation of an octave. Also counts the samples as evaluated octaves.
+     *
+     * @param octave  Octave index. Octaves from max_octaves on are recorded as the last one.
+     * @param samples Number of points the octave was evaluated at
+     * @param elapsed Cycles spent on the evaluation
+     */
+    static void add_octave(int octave, std::uint64_t samples, std::uint64_t elapsed) noexcept
+    {
+        auto& own = local();
+        auto const i = std::min(octave, max_octaves - 1);
+        increment(own.counters[static_cast<int>(counter::octaves)], samples);
+        increment(own.octave_samples[i], samples);
+        increment(own.octave_cycles[i], elapsed);
+    }
+
+    /**
+     * @return Sum of the counters of all threads
+     */
+    static instrumentation_snapshot snapshot()
+    {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        instrumentation_snapshot result = reg.exited;
+        for (auto const* counters : reg.threads)
+            counters->add_to(result);
+        return result;
+    }
+
+  private:
+    /**
+     * Counters of a single thread. Only the owning thread writes them, other threads may read.
+     */
+    struct thread_counters
+    {
+        std::array<std::atomic<std::uint64_t>, num_counters> counters{};
+        std::array<std::atomic<std::uint64_t>, max_octaves> octave_samples{};
+        std::array<std::atomic<std::uint64_t>, max_octaves> octave_cycles{};
+
+        void add_to(instrumentation_snapshot& snapshot) const noexcept
+        {
+            for (int c = 0; c < num_counters; ++c)
+                snapshot.counters[c] += counters[c].load(std::memory_order_relaxed);
+            for (int i = 0; i < max_octaves; ++i)
+            {
+                snapshot.octave_samples[i] += octave_samples[i].load(std::memory_order_relaxed);
+                snapshot.octave_cycles[i] += octave_cycles[i].load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct counter_registry
+    {
+        std::mutex mutex;
+        std::vector<thread_counters const*> threads;
+        instrumentation_snapshot exited; // Sum of the counters of all exited threads
+    };
+
+    /**
+     * Registers the counters of a thread while it is running
+     */
+    struct thread_registration
+    {
+        thread_counters counters;
+
+        thread_registration()
+        {
+            auto& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.threads.push_back(&counters);
+        }
+
+        ~thread_registration()
+        {
+            auto& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            counters.add_to(reg.exited);
+            reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), &counters));
+        }
+    };
+
+    static counter_registry& registry()
+    {
+        static counter_registry reg;
+        return reg;
+    }
+
+    static thread_counters& local() noexcept
+    {
+        thread_local thread_registration registration;
+        return registration.counters;
+    }
+
+    static void increment(std::atomic<std::uint64_t>& value, std::uint64_t n) noexcept
+    {
+        // The owning thread is the only writer, so this needs no atomic read-modify-write
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_INSTRUMENTATION_H
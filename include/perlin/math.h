@@ -82,6 +82,39 @@ static_assert(ipow(-1, 2) == 1);
 static_assert(ipow(-2, 2) == 4);
 static_assert(ipow(-2, 1) == -2);
 
+/**
+ * Compute integer square roots
+ * @tparam T Integral type
+ * @param n  Non-negative radicand
+ * @return   Largest integer whose square is not greater than n
+ */
+template<typename T>
+constexpr T isqrt(T n) noexcept
+{
+    static_assert(std::is_integral_v<T>, "Can only compute integer square roots");
+
+    if (n < 2)
+        return n;
+
+    // Newton's method on integers decreases monotonically towards the floor of the root
+    T current = n;
+    T next = current / 2 + (current & 1);
+    while (next < current)
+    {
+        current = next;
+        next = (current + n / current) / 2;
+    }
+    return current;
+}
+static_assert(isqrt(0) == 0);
+static_assert(isqrt(1) == 1);
+static_assert(isqrt(2) == 1);
+static_assert(isqrt(4) == 2);
+static_assert(isqrt(15) == 3);
+static_assert(isqrt(16) == 4);
+static_assert(isqrt(1ll << 48) == 1ll << 24);
+static_assert(isqrt((1ll << 48) - 1) == (1ll << 24) - 1);
+
 /**
  * Compute powers with integer exponent
  * @tparam T   Input and return arithmetic type
@@ -189,6 +222,63 @@ static_assert(static_powi<-1>(1) == 1);
 static_assert(static_powi<-3>(2.f) == 0.125f);
 static_assert(static_powi<7>(2.f) == 128.f);
 
+/**
+ * Square root that can be evaluated at compile time
+ * @tparam T Floating point type
+ * @param x  Non-negative radicand
+ * @return   Square root of x
+ */
+template<typename T>
+constexpr T constexpr_sqrt(T x) noexcept
+{
+    static_assert(std::is_floating_point_v<T>, "T must be a floating point type");
+
+    if (x <= 0)
+        return 0;
+
+    // Starting above the root, Newton's method decreases monotonically until rounding stalls it
+    T current = x < 1 ? T{1} : x;
+    T previous = 0;
+    while (current != previous)
+    {
+        previous = current;
+        current = (current + x / current) / 2;
+        if (current >= previous)
+            return previous;
+    }
+    return current;
+}
+static_assert(constexpr_sqrt(0.0) == 0);
+static_assert(constexpr_sqrt(1.0) == 1);
+static_assert(constexpr_sqrt(4.0) == 2);
+static_assert(constexpr_sqrt(0.25) == 0.5);
+static_assert(constexpr_sqrt(2.0) - 1.41421356237 < 1e-10);
+static_assert(constexpr_sqrt(3.f) - 1.7320508f < 1e-6f);
+
+/**
+ * Floor function that can be evaluated at compile time
+ * @tparam I Integral result type
+ * @tparam T Floating point type
+ * @param x  Value whose floor is representable by I
+ * @return   Largest integer not greater than x
+ */
+template<typename I, typename T>
+constexpr I constexpr_floor(T x) noexcept
+{
+    static_assert(std::is_integral_v<I>, "I must be an integral type");
+    static_assert(std::is_floating_point_v<T>, "T must be a floating point type");
+
+    // Conversion truncates towards zero, which is one too large for negative non-integers
+    auto const truncated = static_cast<I>(x);
+    return x < static_cast<T>(truncated) ? truncated - 1 : truncated;
+}
+static_assert(constexpr_floor<int>(0.0) == 0);
+static_assert(constexpr_floor<int>(0.5) == 0);
+static_assert(constexpr_floor<int>(1.0) == 1);
+static_assert(constexpr_floor<int>(-0.5) == -1);
+static_assert(constexpr_floor<int>(-1.0) == -1);
+static_assert(constexpr_floor<int>(-1.5f) == -2);
+
 /**
  * Binomial coefficient
  * @tparam T Integral type
@@ -293,6 +383,57 @@ static_assert(smoothstep<2>(0.3) - 0.16308 < 1e-5);
 static_assert(smoothstep<2>(0.5) - 0.5 < 1e-5);
 static_assert(smoothstep<2>(1.0) - 1 < 1e-5);
 
+/**
+ * Derivative of the smoothstep function
+ *
+ * @details  Derivative of smoothstep<N> with respect to x. Outside of the range [0,1] smoothstep is
+ * constant, so its derivative is 0 there.
+ * @tparam N Function order
+ * @tparam T Arithmetic result type
+ * @param x  Evaluation point
+ * @return
+ */
+template<int N, typename T>
+constexpr T smoothstep_derivative(T x) noexcept
+{
+    static_assert(N >= 0, "N must be a nonnegative integer");
+    static_assert(std::is_arithmetic_v<T>, "T must be arithemtic type");
+
+    if (x <= 0 || x >= 1)
+        return 0;
+
+    if constexpr (N == 0)
+    {
+        return 1;
+    }
+    else if constexpr (N == 1)
+    {
+        return 6 * x - 6 * static_powi<2>(x);
+    }
+    else if constexpr (N == 2)
+    {
+        return 30 * static_powi<4>(x) - 60 * static_powi<3>(x) + 30 * static_powi<2>(x);
+    }
+    else
+    {
+        T sum = 0;
+        static_for<N + 1>([&sum, &x](auto n) {
+            sum += n_choose_k<int>(N + n, n) * n_choose_k<int>(2 * N + 1, N - n) * (N + 1 + n)
+                   * static_powi<n>(-x);
+        });
+        return static_powi<N>(x) * sum;
+    }
+}
+static_assert(smoothstep_derivative<0>(-1.0) == 0);
+static_assert(smoothstep_derivative<0>(0.5) - 1 < 1e-5);
+static_assert(smoothstep_derivative<1>(0.0) == 0);
+static_assert(smoothstep_derivative<1>(0.3) - 1.26 < 1e-5);
+static_assert(smoothstep_derivative<1>(0.5) - 1.5 < 1e-5);
+static_assert(smoothstep_derivative<1>(1.0) == 0);
+static_assert(smoothstep_derivative<2>(0.3) - 1.323 < 1e-5);
+static_assert(smoothstep_derivative<2>(0.5) - 1.875 < 1e-5);
+static_assert(smoothstep_derivative<2>(2.0) == 0);
+
 /**
  * Modulo for integers
  *
@@ -0,0 +1,726 @@
+/**********************************************************
+ * @file   noise_expression.h
+ * @author jan
+ * @date   7/31/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_NOISE_EXPRESSION_H
+#define PERLINNOISE_NOISE_EXPRESSION_H
+
+#include "perlin/generator_traits.h"
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace noise
+{
+/**
+ * Consecutive points of a regular grid along its first dimension
+ *
+ * @details Holds the points origin + (first + (i, 0, ..., 0)) * step for 0 <= i < count, computed
+ * exactly like fill_grid() of the generators computes them.
+ */
+template<typename T, int Dim>
+struct grid_row
+{
+    point<T, Dim> origin;
+    vector<T, Dim> step;
+    point<int, Dim> first;
+    int count;
+
+    /**
+     * @param i Index within the row
+     * @return  Point at that index
+     */
+    point<T, Dim> at(int i) const noexcept
+    {
+        point<T, Dim> p;
+        for (int d = 0; d < Dim; ++d)
+            p[d] = origin[d] + static_cast<T>(first[d] + (d == 0 ? i : 0)) * step[d];
+        return p;
+    }
+};
+
+/**
+ * Base of all nodes of a noise expression, which combines generators into a single generator.
+ *
+ * @details Expressions are built from generators wrapped by source() and the functions add(),
+ * mul(), scale_bias(), ridged(), select() and warp(). Every node evaluates blocks of up to
+ * block_size points at a time, keeping the values of its children in buffers on the stack. So
+ * fill_grid() evaluates the whole expression in a single pass over the output, without any
+ * intermediate maps. Sources needed at all points of a block are evaluated with the fill_grid() of
+ * their generator, other sources with their batch at() if available.
+ *
+ *          Nodes only evaluate children at points whose values are needed, e.g. select()
+ * evaluates each branch only at the points mapped to it. The results are identical to evaluating
+ * the expression at every point with at().
+ *
+ *          Nodes are small and copied into their parents. Sources refer to their generators, which
+ * must outlive the expression.
+ *
+ * @tparam Derived Node type
+ * @tparam Result  Arithmetic result type
+ * @tparam Dim     Dimensionality of the expression
+ */
+template<class Derived, typename Result, int Dim>
+class noise_expression
+{
+  public:
+    using result_t = Result;
+    using row_t = grid_row<Result, Dim>;
+
+    static constexpr const int dimensions = Dim;
+    static constexpr const int block_size = 64;
+
+    /**
+     * Evaluate the expression at a given point.
+     *
+     * @param p Point of evaluation
+     * @return  Value of the expression at the specified point
+     */
+    result_t at(point<result_t, Dim> const& p) const noexcept { return derived().value(p); }
+
+    /**
+     * Evaluate the expression at multiple points, one block at a time.
+     *
+     * @tparam InputIt  Input iterator over point<result_t, Dim>
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param first     Begin of the range of evaluation points
+     * @param last      End of the range of evaluation points
+     * @param out       Destination of the values
+     * @return          Output iterator one past the last written value
+     */
+    template<class InputIt, class OutputIt>
+    OutputIt at(InputIt first, InputIt last, OutputIt out) const
+    {
+        std::array<point<result_t, Dim>, block_size> points;
+        std::array<result_t, block_size> values;
+        while (first != last)
+        {
+            int n = 0;
+            for (; n < block_size && first != last; ++n, ++first)
+                points[n] = *first;
+            derived().eval_points(points.data(), n, values.data());
+            out = std::copy_n(values.begin(), n, out);
+        }
+        return out;
+    }
+
+    /**
+     * Evaluate the expression on a regular grid of points.
+     *
+     * @details The grid spans the points origin + i * step for all 0 <= i < extents. Values are
+     * written in row-major order, with the first dimension varying fastest.
+     *
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param origin    First point of the grid
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param extents   Number of grid points along each dimension
+     * @param out       Destination of the prod(extents) values
+     * @return          Output iterator one past the last written value
+     */
+    template<class OutputIt>
+    OutputIt fill_grid(point<result_t, Dim> const& origin,
+                       vector<result_t, Dim> const& step,
+                       point<int, Dim> const& extents,
+                       OutputIt out) const
+    {
+        return fill_grid(origin, step, point<int, Dim>{}, extents, out);
+    }
+
+    /**
+     * Evaluate the expression on a section of a regular grid of points.
+     *
+     * @details Like fill_grid(origin, step, extents, out), but only evaluates the points
+     * origin + i * step for first <= i < first + extents.
+     *
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param origin    Point of the grid at index 0
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param first     Index of the first grid point of the section
+     * @param extents   Number of grid points of the section along each dimension
+     * @param out       Destination of the prod(extents) values
+     * @return          Output iterator one past the last written value
+     */
+    template<class OutputIt>
+    OutputIt fill_grid(point<result_t, Dim> const& origin,
+                       vector<result_t, Dim> const& step,
+                       point<int, Dim> const& first,
+                       point<int, Dim> const& extents,
+                       OutputIt out) const
+    {
+        if (std::any_of(extents.begin(), extents.end(), [](int e) { return e <= 0; }))
+            return out;
+
+        std::array<result_t, block_size> values;
+        point<int, Dim> idx{};
+        while (true)
+        {
+            for (int x = 0; x < extents[0]; x += block_size)
+            {
+                row_t row{origin, step, first, std::min(block_size, extents[0] - x)};
+                row.first[0] += x;
+                for (int d = 1; d < Dim; ++d)
+                    row.first[d] += idx[d];
+                derived().eval_row(row, values.data());
+                out = std::copy_n(values.begin(), row.count, out);
+            }
+
+            // Advance to the next row
+            int d = 1;
+            for (; d < Dim && ++idx[d] == extents[d]; ++d)
+                idx[d] = 0;
+            if (d == Dim)
+                return out;
+        }
+    }
+
+  protected:
+    /**
+     * @param row    Row of at most block_size points
+     * @param points Destination of the points of the row
+     */
+    static void row_points(row_t const& row, point<result_t, Dim>* points) noexcept
+    {
+        for (int i = 0; i < row.count; ++i)
+            points[i] = row.at(i);
+    }
+
+  private:
+    Derived const& derived() const noexcept { return static_cast<Derived const&>(*this); }
+};
+
+/**
+ * Checks whether a type is a node of a noise expression
+ * @tparam T Any type
+ */
+template<class T>
+constexpr bool const is_noise_expression_v = std::is_base_of_v<
+    noise_expression<T, typename T::result_t, T::dimensions>,
+    T>;
+
+/**
+ * Leaf of a noise expression, evaluating a generator
+ * @tparam Gen Noise generator
+ */
+template<class Gen>
+class noise_source
+    : public noise_expression<noise_source<Gen>, typename Gen::result_t, Gen::dimensions>
+{
+  public:
+    using result_t = typename Gen::result_t;
+    using row_t = grid_row<result_t, Gen::dimensions>;
+
+    /**
+     * @param gen Noise generator, which must outlive the expression
+     */
+    explicit noise_source(Gen const& gen) noexcept
+        : m_gen(gen)
+    {
+    }
+
+    result_t value(point<result_t, Gen::dimensions> const& p) const noexcept
+    {
+        return m_gen.at(p);
+    }
+
+    void eval_row(row_t const& row, result_t* out) const
+    {
+        if constexpr (has_fill_grid_v<Gen>)
+        {
+            point<int, Gen::dimensions> extents;
+            extents[0] = row.count;
+            for (int d = 1; d < Gen::dimensions; ++d)
+                extents[d] = 1;
+            m_gen.fill_grid(row.origin, row.step, row.first, extents, out);
+        }
+        else
+        {
+            std::array<point<result_t, Gen::dimensions>, noise_source::block_size> points;
+            noise_source::row_points(row, points.data());
+            eval_points(points.data(), row.count, out);
+        }
+    }
+
+    void eval_points(point<result_t, Gen::dimensions> const* points, int n, result_t* out) const
+    {
+        if constexpr (has_batch_at_v<Gen>)
+            m_gen.at(points, points + n, out);
+        else
+            std::transform(points, points + n, out, [this](auto const& p) { return m_gen.at(p); });
+    }
+
+  private:
+    Gen const& m_gen;
+};
+
+/**
+ * Element-wise combination of two noise expressions
+ *
+ * @tparam A  Left operand
+ * @tparam B  Right operand
+ * @tparam Op Binary function object combining the values
+ */
+template<class A, class B, class Op>
+class noise_combination
+    : public noise_expression<noise_combination<A, B, Op>, typename A::result_t, A::dimensions>
+{
+  public:
+    static_assert(std::is_same_v<typename A::result_t, typename B::result_t>,
+                  "Operands must have the same result type");
+    static_assert(A::dimensions == B::dimensions, "Operands must have the same dimensions");
+
+    using result_t = typename A::result_t;
+    using row_t = grid_row<result_t, A::dimensions>;
+
+    noise_combination(A a, B b) noexcept
+        : m_a(std::move(a))
+        , m_b(std::move(b))
+    {
+    }
+
+    result_t value(point<result_t, A::dimensions> const& p) const noexcept
+    {
+        return Op{}(m_a.value(p), m_b.value(p));
+    }
+
+    void eval_row(row_t const& row, result_t* out) const
+    {
+        std::array<result_t, noise_combination::block_size> b;
+        m_a.eval_row(row, out);
+        m_b.eval_row(row, b.data());
+        combine(row.count, out, b.data());
+    }
+
+    void eval_points(point<result_t, A::dimensions> const* points, int n, result_t* out) const
+    {
+        std::array<result_t, noise_combination::block_size> b;
+        m_a.eval_points(points, n, out);
+        m_b.eval_points(points, n, b.data());
+        combine(n, out, b.data());
+    }
+
+  private:
+    A m_a;
+    B m_b;
+
+    static void combine(int n, result_t* a, result_t const* b) noexcept
+    {
+        for (int i = 0; i < n; ++i)
+            a[i] = Op{}(a[i], b[i]);
+    }
+};
+
+template<class A, class B>
+using noise_sum = noise_combination<A, B, std::plus<typename A::result_t>>;
+
+template<class A, class B>
+using noise_product = noise_combination<A, B, std::multiplies<typename A::result_t>>;
+
+/**
+ * Element-wise transformation of a noise expression
+ *
+ * @tparam A  Operand
+ * @tparam Op Function object transforming a value, stored in the node
+ */
+template<class A, class Op>
+class noise_transform
+    : public noise_expression<noise_transform<A, Op>, typename A::result_t, A::dimensions>
+{
+  public:
+    using result_t = typename A::result_t;
+    using row_t = grid_row<result_t, A::dimensions>;
+
+    noise_transform(A a, Op op) noexcept
+        : m_a(std::move(a))
+        , m_op(std::move(op))
+    {
+    }
+
+    result_t value(point<result_t, A::dimensions> const& p) const noexcept
+    {
+        return m_op(m_a.value(p));
+    }
+
+    void eval_row(row_t const& row, result_t* out) const
+    {
+        m_a.eval_row(row, out);
+        std::transform(out, out + row.count, out, m_op);
+    }
+
+    void eval_points(point<result_t, A::dimensions> const* points, int n, result_t* out) const
+    {
+        m_a.eval_points(points, n, out);
+        std::transform(out, out + n, out, m_op);
+    }
+
+  private:
+    A m_a;
+    Op m_op;
+};
+
+/**
+ * Maps a value v to v * scale + bias
+ * @tparam T Arithmetic type
+ */
+template<typename T>
+struct scale_bias_op
+{
+    T scale;
+    T bias;
+
+    constexpr T operator()(T v) const noexcept { return v * scale + bias; }
+};
+
+/**
+ * Maps a value v in [-1, 1] to 1 - 2 * |v|, which turns the zero crossings of noise into sharp
+ * ridges of value 1
+ * @tparam T Arithmetic type
+ */
+template<typename T>
+struct ridged_op
+{
+    constexpr T operator()(T v) const noexcept { return 1 - 2 * std::abs(v); }
+};
+
+/**
+ * Chooses between two noise expressions by the value of a third
+ *
+ * @details Points with a control value below threshold - falloff take the value of the lower
+ * expression, points with a control value of at least threshold + falloff the value of the upper
+ * one. In between, both are blended with a smoothstep. A NaN control value falls in between as
+ * well, so both expressions are evaluated and the blend takes the upper value. An expression is
+ * only evaluated at the points that need it, and as a whole row only if all points of the row need
+ * it.
+ *
+ * @tparam C Control expression
+ * @tparam L Lower expression
+ * @tparam U Upper expression
+ */
+template<class C, class L, class U>
+class noise_select
+    : public noise_expression<noise_select<C, L, U>, typename C::result_t, C::dimensions>
+{
+  public:
+    static_assert(std::is_same_v<typename C::result_t, typename L::result_t>
+                      && std::is_same_v<typename C::result_t, typename U::result_t>,
+                  "Operands must have the same result type");
+    static_assert(C::dimensions == L::dimensions && C::dimensions == U::dimensions,
+                  "Operands must have the same dimensions");
+
+    using result_t = typename C::result_t;
+    using row_t = grid_row<result_t, C::dimensions>;
+
+    noise_select(C control, L lower, U upper, result_t threshold, result_t falloff) noexcept
+        : m_control(std::move(control))
+        , m_lower(std::move(lower))
+        , m_upper(std::move(upper))
+        , m_lowerEdge(threshold - falloff)
+        , m_upperEdge(threshold + falloff)
+    {
+    }
+
+    result_t value(point<result_t, C::dimensions> const& p) const noexcept
+    {
+        auto const control = m_control.value(p);
+        if (control < m_lowerEdge)
+            return m_lower.value(p);
+        if (control >= m_upperEdge)
+            return m_upper.value(p);
+        return blend(control, m_lower.value(p), m_upper.value(p));
+    }
+
+    void eval_row(row_t const& row, result_t* out) const
+    {
+        eval(
+            row.count,
+            out,
+            [&](auto const& node, result_t* values) { node.eval_row(row, values); },
+            [&](int i) { return row.at(i); });
+    }
+
+    void eval_points(point<result_t, C::dimensions> const* points, int n, result_t* out) const
+    {
+        eval(
+            n,
+            out,
+            [&](auto const& node, result_t* values) { node.eval_points(points, n, values); },
+            [&](int i) { return points[i]; });
+    }
+
+  private:
+    C m_control;
+    L m_lower;
+    U m_upper;
+    result_t m_lowerEdge;
+    result_t m_upperEdge;
+
+    result_t blend(result_t control, result_t lower, result_t upper) const noexcept
+    {
+        auto const weight = smoothstep<1>((control - m_lowerEdge) / (m_upperEdge - m_lowerEdge));
+        return lower + weight * (upper - lower);
+    }
+
+    /**
+     * @param n       Number of points
+     * @param out     Destination of the values
+     * @param evalAll Function evaluating a child node at all points into a buffer
+     * @param pointAt Function returning the point at an index
+     */
+    template<class EvalAll, class PointAt>
+    void eval(int n, result_t* out, EvalAll&& evalAll, PointAt&& pointAt) const
+    {
+        std::array<result_t, noise_select::block_size> control;
+        evalAll(m_control, control.data());
+
+        std::array<int, noise_select::block_size> lowerIndices;
+        std::array<int, noise_select::block_size> upperIndices;
+        int numLower = 0;
+        int numUpper = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            // Negated comparisons, so that NaN control values need both expressions like in value()
+            lowerIndices[numLower] = i;
+            numLower += !(control[i] >= m_upperEdge);
+            upperIndices[numUpper] = i;
+            numUpper += !(control[i] < m_lowerEdge);
+        }
+
+        // Values at points that don't need an expression are never read
+        std::array<result_t, noise_select::block_size> lower;
+        std::array<result_t, noise_select::block_size> upper;
+        eval_subset(m_lower, n, lowerIndices.data(), numLower, lower.data(), evalAll, pointAt);
+        eval_subset(m_upper, n, upperIndices.data(), numUpper, upper.data(), evalAll, pointAt);
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (control[i] < m_lowerEdge)
+                out[i] = lower[i];
+            else if (control[i] >= m_upperEdge)
+                out[i] = upper[i];
+            else
+                out[i] = blend(control[i], lower[i], upper[i]);
+        }
+    }
+
+    /**
+     * Evaluate a child node at some of the points
+     *
+     * @details Uses the evaluation of all points if all of them are needed, so that sources can be
+     * evaluated as grids. Otherwise, only the needed points are gathered and evaluated.
+     *
+     * @param node       Child node
+     * @param n          Number of points
+     * @param indices    Ascending indices of the needed points
+     * @param numIndices Number of needed points
+     * @param values     Destination of the values at the indices
+     * @param evalAll    Function evaluating a child node at all points into a buffer
+     * @param pointAt    Function returning the point at an index
+     */
+    template<class Node, class EvalAll, class PointAt>
+    static void eval_subset(Node const& node,
+                            int n,
+                            int const* indices,
+                            int numIndices,
+                            result_t* values,
+                            EvalAll&& evalAll,
+                            PointAt&& pointAt)
+    {
+        if (numIndices == n)
+        {
+            evalAll(node, values);
+            return;
+        }
+        if (numIndices == 0)
+            return;
+
+        std::array<point<result_t, C::dimensions>, noise_select::block_size> points;
+        std::array<result_t, noise_select::block_size> subset;
+        for (int k = 0; k < numIndices; ++k)
+            points[k] = pointAt(indices[k]);
+        node.eval_points(points.data(), numIndices, subset.data());
+        for (int k = 0; k < numIndices; ++k)
+            values[indices[k]] = subset[k];
+    }
+};
+
+/**
+ * Evaluates a noise expression at points displaced by other noise expressions
+ *
+ * @details The source is evaluated at p + strength * (w_0(p), ..., w_Dim-1(p)), where w_d are the
+ * warp expressions. The warp expressions are evaluated at the undisplaced points, so they can make
+ * use of fill_grid(). The source can't.
+ *
+ * @tparam S     Source expression
+ * @tparam Warps One warp expression per dimension
+ */
+template<class S, class... Warps>
+class noise_warp
+    : public noise_expression<noise_warp<S, Warps...>, typename S::result_t, S::dimensions>
+{
+  public:
+    static_assert(sizeof...(Warps) == S::dimensions, "Need one warp expression per dimension");
+    static_assert((std::is_same_v<typename S::result_t, typename Warps::result_t> && ...),
+                  "Operands must have the same result type");
+    static_assert(((S::dimensions == Warps::dimensions) && ...),
+                  "Operands must have the same dimensions");
+
+    using result_t = typename S::result_t;
+    using row_t = grid_row<result_t, S::dimensions>;
+
+    static constexpr const int dimensions = S::dimensions;
+
+    noise_warp(S source, result_t strength, Warps... warps) noexcept
+        : m_source(std::move(source))
+        , m_strength(strength)
+        , m_warps(std::move(warps)...)
+    {
+    }
+
+    result_t value(point<result_t, dimensions> const& p) const noexcept
+    {
+        auto q = p;
+        static_for<dimensions>([&](auto d) {
+            q[d] = p[d] + m_strength * std::get<decltype(d)::value>(m_warps).value(p);
+        });
+        return m_source.value(q);
+    }
+
+    void eval_row(row_t const& row, result_t* out) const
+    {
+        std::array<point<result_t, dimensions>, noise_warp::block_size> points;
+        noise_warp::row_points(row, points.data());
+        warp(points.data(), row.count, out, [&](auto const& warp, result_t* values) {
+            warp.eval_row(row, values);
+        });
+    }
+
+    void eval_points(point<result_t, dimensions> const* points, int n, result_t* out) const
+    {
+        warp(points, n, out, [&](auto const& warp, result_t* values) {
+            warp.eval_points(points, n, values);
+        });
+    }
+
+  private:
+    S m_source;
+    result_t m_strength;
+    std::tuple<Warps...> m_warps;
+
+    /**
+     * @param points Undisplaced points
+     * @param n      Number of points
+     * @param out    Destination of the values
+     * @param eval   Function evaluating a warp expression at the points into a buffer
+     */
+    template<class Eval>
+    void warp(point<result_t, dimensions> const* points,
+              int n,
+              result_t* out,
+              Eval&& eval) const
+    {
+        std::array<point<result_t, dimensions>, noise_warp::block_size> displaced;
+        std::copy_n(points, n, displaced.begin());
+
+        std::array<result_t, noise_warp::block_size> offsets;
+        static_for<dimensions>([&](auto d) {
+            eval(std::get<decltype(d)::value>(m_warps), offsets.data());
+            for (int i = 0; i < n; ++i)
+                displaced[i][d] = points[i][d] + m_strength * offsets[i];
+        });
+        m_source.eval_points(displaced.data(), n, out);
+    }
+};
+
+/**
+ * @param gen Noise generator, which must outlive the expression
+ * @return    Expression evaluating the generator
+ */
+template<class Gen>
+noise_source<Gen> source(Gen const& gen) noexcept
+{
+    return noise_source<Gen>(gen);
+}
+
+/**
+ * @return Expression evaluating to a + b
+ */
+template<class A, class B, typename = std::enable_if_t<is_noise_expression_v<A>>>
+noise_sum<A, B> add(A a, B b) noexcept
+{
+    return {std::move(a), std::move(b)};
+}
+
+/**
+ * @return Expression evaluating to a * b
+ */
+template<class A, class B, typename = std::enable_if_t<is_noise_expression_v<A>>>
+noise_product<A, B> mul(A a, B b) noexcept
+{
+    return {std::move(a), std::move(b)};
+}
+
+/**
+ * @return Expression evaluating to a * scale + bias
+ */
+template<class A, typename = std::enable_if_t<is_noise_expression_v<A>>>
+noise_transform<A, scale_bias_op<typename A::result_t>> scale_bias(A a,
+                                                                   typename A::result_t scale,
+                                                                   typename A::result_t bias)
+    noexcept
+{
+    return {std::move(a), {scale, bias}};
+}
+
+/**
+ * @return Expression evaluating to 1 - 2 * |a|, see ridged_op
+ */
+template<class A, typename = std::enable_if_t<is_noise_expression_v<A>>>
+noise_transform<A, ridged_op<typename A::result_t>> ridged(A a) noexcept
+{
+    return {std::move(a), {}};
+}
+
+/**
+ * @param control   Expression choosing between lower and upper
+ * @param lower     Expression used where the control value is below the threshold
+ * @param upper     Expression used where the control value is at least the threshold
+ * @param threshold Control value separating lower and upper
+ * @param falloff   Half the width of the control value range blending lower and upper
+ * @return          Expression choosing between lower and upper, see noise_select
+ */
+template<class C, class L, class U, typename = std::enable_if_t<is_noise_expression_v<C>>>
+noise_select<C, L, U> select(C control,
+                             L lower,
+                             U upper,
+                             typename C::result_t threshold,
+                             typename C::result_t falloff = 0) noexcept
+{
+    return {std::move(control), std::move(lower), std::move(upper), threshold, falloff};
+}
+
+/**
+ * @param source   Expression to evaluate at displaced points
+ * @param strength Factor applied to the displacements
+ * @param warps    One expression per dimension, yielding the displacement along that dimension
+ * @return         Expression evaluating the source at displaced points, see noise_warp
+ */
+template<class S, class... Warps, typename = std::enable_if_t<is_noise_expression_v<S>>>
+noise_warp<S, Warps...> warp(S source, typename S::result_t strength, Warps... warps) noexcept
+{
+    return {std::move(source), strength, std::move(warps)...};
+}
+
+} // namespace noise
+
+#endif // PERLINNOISE_NOISE_EXPRESSION_H
@@ -0,0 +1,381 @@
+/**********************************************************
+ * @file   noise_map_renderer.h
+ * @author jan
+ * @date   7/21/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_NOISE_MAP_RENDERER_H
+#define PERLINNOISE_NOISE_MAP_RENDERER_H
+
+#include "perlin/generator_traits.h"
+#include "perlin/point.h"
+#include "perlin/thread_pool.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <array>
+
+namespace noise
+{
+/**
+ * Evaluate a tile of a 2d grid through fill_grid(), converting the values on the fly.
+ *
+ * @details The tile is evaluated in bands of up to 4096 values, whole tiles for tile sizes of up
+ * to 64 pixels. Each band is held in a fixed-size buffer on the stack and converted while it is
+ * still in cache, so the tile is rendered without allocating.
+ *
+ * @tparam TileSize Maximum width of the tile
+ * @tparam Gen      Two-dimensional noise generator providing fill_grid()
+ * @tparam RandomIt Random access iterator accepting the results of quantize
+ * @tparam Quantize Function converting Gen::result_t to the output type
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the grid index (0, 0)
+ * @param step      Distance between adjacent grid points
+ * @param first     Grid index of the first pixel of the tile
+ * @param extents   Width, at most TileSize, and height of the tile in pixels
+ * @param out       Destination of the first pixel of the tile
+ * @param rowStride Distance between the first pixels of adjacent rows in the destination
+ * @param quantize  Function to convert noise values
+ */
+template<int TileSize, class Gen, class RandomIt, class Quantize>
+void fill_grid_tile(Gen const& gen,
+                    point2d<typename Gen::result_t> const& origin,
+                    vec2d<typename Gen::result_t> const& step,
+                    point2d_i const& first,
+                    point2d_i const& extents,
+                    RandomIt out,
+                    std::ptrdiff_t rowStride,
+                    Quantize quantize)
+{
+    static_assert(TileSize > 0, "Tiles must not be empty");
+
+    constexpr int const bandRows = std::max(4096 / TileSize, 1);
+    std::array<typename Gen::result_t, TileSize * bandRows> values;
+    for (int y0 = 0; y0 < extents[1]; y0 += bandRows)
+    {
+        int const rows = std::min(bandRows, extents[1] - y0);
+        gen.fill_grid(origin,
+                      step,
+                      point2d_i{first[0], first[1] + y0},
+                      point2d_i{extents[0], rows},
+                      values.data());
+        for (int y = 0; y < rows; ++y)
+        {
+            auto const row = values.begin() + y * extents[0];
+            std::transform(row, row + extents[0], out + (y0 + y) * rowStride, quantize);
+        }
+    }
+}
+
+/**
+ * Render a section of a 2d noise map in parallel, converting the values on the fly.
+ *
+ * @details Like render_noise_map_section(), but passes every value through quantize before
+ * storing it.
+ * The conversion is fused into the evaluation, so no intermediate buffer of the whole map is
+ * needed, e.g. to write 8 bit or half precision textures directly.
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Noise generator
+ * @tparam RandomIt Random access iterator accepting the results of quantize
+ * @tparam MapPoint Function mapping a 2d point to a point<Gen::result_t, Gen::dimensions>
+ * @tparam Quantize Function converting Gen::result_t to the output type, e.g. a quantizer
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param first     First pixel of the section
+ * @param extents   Width and height of the section in pixels
+ * @param out       Destination of the width * height values in row-major order
+ * @param mapPoint  Function to map 2d points to the generator's domain
+ * @param quantize  Function to convert noise values
+ */
+template<int TileSize = 64, class Gen, class RandomIt, class MapPoint, class Quantize>
+void render_quantized_noise_map_section(thread_pool& pool,
+                                        Gen const& gen,
+                                        point2d<typename Gen::result_t> const& origin,
+                                        vec2d<typename Gen::result_t> const& step,
+                                        point2d_i const& first,
+                                        point2d_i const& extents,
+                                        RandomIt out,
+                                        MapPoint mapPoint,
+                                        Quantize quantize)
+{
+    static_assert(TileSize > 0, "Tiles must not be empty");
+
+    using result_t = typename Gen::result_t;
+
+    int const width = extents[0];
+    int const height = extents[1];
+    if (width <= 0 || height <= 0)
+        return;
+
+    int const tilesX = (width + TileSize - 1) / TileSize;
+    int const tilesY = (height + TileSize - 1) / TileSize;
+    pool.parallel_for(static_cast<std::size_t>(tilesX) * tilesY, [&](std::size_t tile) {
+        int const x0 = static_cast<int>(tile % tilesX) * TileSize;
+        int const y0 = static_cast<int>(tile / tilesX) * TileSize;
+        int const x1 = std::min(x0 + TileSize, width);
+        int const y1 = std::min(y0 + TileSize, height);
+
+        for (int y = y0; y < y1; ++y)
+        {
+            auto const yPos = origin[1] + static_cast<result_t>(first[1] + y) * step[1];
+            auto rowOut = out + (static_cast<std::ptrdiff_t>(y) * width + x0);
+            for (int x = x0; x < x1; ++x)
+            {
+                auto const xPos = origin[0] + static_cast<result_t>(first[0] + x) * step[0];
+                *rowOut++ = quantize(gen.at(mapPoint(point2d<result_t>{xPos, yPos})));
+            }
+        }
+    });
+}
+
+/**
+ * Render a section of a 2d noise map of a 2d generator in parallel, converting the values on the
+ * fly.
+ *
+ * @details Like the overload taking a point mapping function, but evaluates the generator at
+ * origin + (x, y) * step directly. Generators providing fill_grid() are evaluated through it
+ * tile by tile with fill_grid_tile(), which converts the values without allocating.
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Two-dimensional noise generator
+ * @tparam RandomIt Random access iterator accepting the results of quantize
+ * @tparam Quantize Function converting Gen::result_t to the output type, e.g. a quantizer
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param first     First pixel of the section
+ * @param extents   Width and height of the section in pixels
+ * @param out       Destination of the width * height values in row-major order
+ * @param quantize  Function to convert noise values
+ */
+template<int TileSize = 64, class Gen, class RandomIt, class Quantize>
+void render_quantized_noise_map_section(thread_pool& pool,
+                                        Gen const& gen,
+                                        point2d<typename Gen::result_t> const& origin,
+                                        vec2d<typename Gen::result_t> const& step,
+                                        point2d_i const& first,
+                                        point2d_i const& extents,
+                                        RandomIt out,
+                                        Quantize quantize)
+{
+    static_assert(Gen::dimensions == 2, "Must use a 2D generator or provide a point mapping");
+
+    using result_t = typename Gen::result_t;
+
+    if constexpr (has_fill_grid_v<Gen>)
+    {
+        static_assert(TileSize > 0, "Tiles must not be empty");
+
+        int const width = extents[0];
+        int const height = extents[1];
+        if (width <= 0 || height <= 0)
+            return;
+
+        int const tilesX = (width + TileSize - 1) / TileSize;
+        int const tilesY = (height + TileSize - 1) / TileSize;
+        pool.parallel_for(static_cast<std::size_t>(tilesX) * tilesY, [&](std::size_t tile) {
+            point2d_i const tileFirst{static_cast<int>(tile % tilesX) * TileSize,
+                                      static_cast<int>(tile / tilesX) * TileSize};
+            point2d_i const tileExtents{std::min(TileSize, width - tileFirst[0]),
+                                        std::min(TileSize, height - tileFirst[1])};
+
+            fill_grid_tile<TileSize>(
+                gen,
+                origin,
+                step,
+                point2d_i{first[0] + tileFirst[0], first[1] + tileFirst[1]},
+                tileExtents,
+                out + (static_cast<std::ptrdiff_t>(tileFirst[1]) * width + tileFirst[0]),
+                width,
+                quantize);
+        });
+    }
+    else
+    {
+        render_quantized_noise_map_section<TileSize>(pool,
+                                                     gen,
+                                                     origin,
+                                                     step,
+                                                     first,
+                                                     extents,
+                                                     out,
+                                                     [](point2d<result_t> const& p) { return p; },
+                                                     quantize);
+    }
+}
+
+/**
+ * Render a 2d noise map of a 2d generator in parallel, converting the values on the fly.
+ *
+ * @details Renders the section of the map starting at pixel (0, 0), see
+ * render_quantized_noise_map_section().
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Two-dimensional noise generator
+ * @tparam RandomIt Random access iterator accepting the results of quantize
+ * @tparam Quantize Function converting Gen::result_t to the output type, e.g. a quantizer
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param extents   Width and height of the map in pixels
+ * @param out       Destination of the width * height values in row-major order
+ * @param quantize  Function to convert noise values
+ */
+template<int TileSize = 64, class Gen, class RandomIt, class Quantize>
+void render_quantized_noise_map(thread_pool& pool,
+                                Gen const& gen,
+                                point2d<typename Gen::result_t> const& origin,
+                                vec2d<typename Gen::result_t> const& step,
+                                point2d_i const& extents,
+                                RandomIt out,
+                                Quantize quantize)
+{
+    render_quantized_noise_map_section<TileSize>(
+        pool, gen, origin, step, point2d_i{}, extents, out, quantize);
+}
+
+/**
+ * Render a section of a 2d noise map in parallel.
+ *
+ * @details The section is split into square tiles of TileSize pixels, which are distributed over
+ * the threads of the pool. The pixel at (x, y) is mapped to the point
+ * mapPoint(origin + (x, y) * step) before evaluating the generator. The result doesn't depend on
+ * the tile size, the number of threads or how the map is split into sections.
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Noise generator
+ * @tparam RandomIt Random access iterator accepting Gen::result_t
+ * @tparam MapPoint Function mapping a 2d point to a point<Gen::result_t, Gen::dimensions>
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param first     First pixel of the section
+ * @param extents   Width and height of the section in pixels
+ * @param out       Destination of the width * height values in row-major order
+ * @param mapPoint  Function to map 2d points to the generator's domain
+ */
+template<int TileSize = 64, class Gen, class RandomIt, class MapPoint>
+void render_noise_map_section(thread_pool& pool,
+                              Gen const& gen,
+                              point2d<typename Gen::result_t> const& origin,
+                              vec2d<typename Gen::result_t> const& step,
+                              point2d_i const& first,
+                              point2d_i const& extents,
+                              RandomIt out,
+                              MapPoint mapPoint)
+{
+    using result_t = typename Gen::result_t;
+
+    render_quantized_noise_map_section<TileSize>(pool,
+                                                 gen,
+                                                 origin,
+                                                 step,
+                                                 first,
+                                                 extents,
+                                                 out,
+                                                 mapPoint,
+                                                 [](result_t value) { return value; });
+}
+
+/**
+ * Render a 2d noise map in parallel.
+ *
+ * @details Renders the section of the map starting at pixel (0, 0), see
+ * render_noise_map_section().
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Noise generator
+ * @tparam RandomIt Random access iterator accepting Gen::result_t
+ * @tparam MapPoint Function mapping a 2d point to a point<Gen::result_t, Gen::dimensions>
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param extents   Width and height of the map in pixels
+ * @param out       Destination of the width * height values in row-major order
+ * @param mapPoint  Function to map 2d points to the generator's domain
+ */
+template<int TileSize = 64, class Gen, class RandomIt, class MapPoint>
+void render_noise_map(thread_pool& pool,
+                      Gen const& gen,
+                      point2d<typename Gen::result_t> const& origin,
+                      vec2d<typename Gen::result_t> const& step,
+                      point2d_i const& extents,
+                      RandomIt out,
+                      MapPoint mapPoint)
+{
+    render_noise_map_section<TileSize>(
+        pool, gen, origin, step, point2d_i{}, extents, out, mapPoint);
+}
+
+/**
+ * Render a section of a 2d noise map of a 2d generator in parallel.
+ *
+ * @details Like the overload taking a point mapping function, but evaluates the generator at
+ * origin + (x, y) * step directly. Generators providing fill_grid() are evaluated one tile at a
+ * time through it.
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Two-dimensional noise generator
+ * @tparam RandomIt Random access iterator accepting Gen::result_t
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param first     First pixel of the section
+ * @param extents   Width and height of the section in pixels
+ * @param out       Destination of the width * height values in row-major order
+ */
+template<int TileSize = 64, class Gen, class RandomIt>
+void render_noise_map_section(thread_pool& pool,
+                              Gen const& gen,
+                              point2d<typename Gen::result_t> const& origin,
+                              vec2d<typename Gen::result_t> const& step,
+                              point2d_i const& first,
+                              point2d_i const& extents,
+                              RandomIt out)
+{
+    using result_t = typename Gen::result_t;
+
+    render_quantized_noise_map_section<TileSize>(
+        pool, gen, origin, step, first, extents, out, [](result_t value) { return value; });
+}
+
+/**
+ * Render a 2d noise map of a 2d generator in parallel.
+ *
+ * @details Renders the section of the map starting at pixel (0, 0), see
+ * render_noise_map_section().
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Two-dimensional noise generator
+ * @tparam RandomIt Random access iterator accepting Gen::result_t
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0)
+ * @param step      Distance between adjacent pixels
+ * @param extents   Width and height of the map in pixels
+ * @param out       Destination of the width * height values in row-major order
+ */
+template<int TileSize = 64, class Gen, class RandomIt>
+void render_noise_map(thread_pool& pool,
+                      Gen const& gen,
+                      point2d<typename Gen::result_t> const& origin,
+                      vec2d<typename Gen::result_t> const& step,
+                      point2d_i const& extents,
+                      RandomIt out)
+{
+    render_noise_map_section<TileSize>(pool, gen, origin, step, point2d_i{}, extents, out);
+}
+
+} // namespace noise
+
+#endif // PERLINNOISE_NOISE_MAP_RENDERER_H
@@ -0,0 +1,228 @@
+/**********************************************************
+ * @file   noise_pyramid.h
+ * @author jan
+ * @date   8/1/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_NOISE_PYRAMID_H
+#define PERLINNOISE_NOISE_PYRAMID_H
+
+#include "perlin/generator_traits.h"
+#include "perlin/noise_map_renderer.h"
+#include "perlin/point.h"
+#include "perlin/thread_pool.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace noise
+{
+/**
+ * Layout of the levels of a 2d mip chain in a single contiguous buffer.
+ *
+ * @details Level 0 has the full extents, every following level half the extents of the previous
+ * one, rounded down to at least 1 pixel. A chain holds the levels from first_level() on, stored one
+ * after another, each in row-major order. Chains starting at a coarser level, e.g. to serve zoom
+ * levels, leave out the finer ones entirely.
+ */
+class mip_chain
+{
+  public:
+    static constexpr int const max_levels = 32;
+
+    /**
+     * @param extents    Width and height of level 0 in pixels
+     * @param numLevels  Number of levels, 0 for all levels down to a single pixel
+     * @param firstLevel Index of the first level of the chain
+     */
+    explicit mip_chain(point2d_i const& extents, int numLevels = 0, int firstLevel = 0) noexcept
+        : m_firstLevel(firstLevel)
+    {
+        auto const maxLevels = std::max(num_levels_of(extents) - firstLevel, 0);
+        m_numLevels = numLevels > 0 ? std::min(numLevels, maxLevels) : maxLevels;
+
+        std::size_t offset = 0;
+        for (int i = 0; i < m_numLevels; ++i)
+        {
+            auto const level = firstLevel + i;
+            m_extents[i] = point2d_i{std::max(extents[0] >> level, 1),
+                                     std::max(extents[1] >> level, 1)};
+            m_offsets[i] = offset;
+            offset += static_cast<std::size_t>(m_extents[i][0]) * m_extents[i][1];
+        }
+        m_size = offset;
+    }
+
+    /**
+     * @param extents Width and height of level 0 in pixels
+     * @return        Number of levels from level 0 down to a single pixel, 0 if empty
+     */
+    static constexpr int num_levels_of(point2d_i const& extents) noexcept
+    {
+        if (extents[0] <= 0 || extents[1] <= 0)
+            return 0;
+
+        int levels = 1;
+        for (int e = std::max(extents[0], extents[1]); e > 1; e >>= 1)
+            ++levels;
+        return levels;
+    }
+
+    /**
+     * @return Index of the first level of the chain
+     */
+    int first_level() const noexcept { return m_firstLevel; }
+
+    /**
+     * @return Number of levels of the chain
+     */
+    int num_levels() const noexcept { return m_numLevels; }
+
+    /**
+     * @param level Level index, from first_level() to first_level() + num_levels() - 1
+     * @return      Width and height of the level in pixels
+     */
+    point2d_i const& extents(int level) const noexcept { return m_extents[level - m_firstLevel]; }
+
+    /**
+     * @param level Level index, from first_level() to first_level() + num_levels() - 1
+     * @return      Index of the first pixel of the level in the buffer
+     */
+    std::size_t offset(int level) const noexcept { return m_offsets[level - m_firstLevel]; }
+
+    /**
+     * @return Number of pixels of all levels together
+     */
+    std::size_t size() const noexcept { return m_size; }
+
+  private:
+    int m_firstLevel = 0;
+    int m_numLevels = 0;
+    std::array<point2d_i, max_levels> m_extents{};
+    std::array<std::size_t, max_levels> m_offsets{};
+    std::size_t m_size = 0;
+};
+
+/**
+ * Render all levels of a 2d mip chain directly from a 2d generator in parallel.
+ *
+ * @details Instead of rendering level 0 and filtering it down, every level of the chain is
+ * evaluated at its own resolution. The pixel at (x, y) of level l covers the pixels
+ * [x * 2^l, (x + 1) * 2^l) along the first and [y * 2^l, (y + 1) * 2^l) along the second axis of
+ * level 0, and is sampled at their center. So level 0 samples origin + (x, y) * step, like
+ * render_noise_map().
+ *
+ *          Generators providing at(p, footprint, tolerance), like fractal_noise_generator, are
+ * given the distance between adjacent pixels of a level as footprint. They skip the octaves that
+ * would alias at that level. Every level has a quarter of the pixels of the previous one and needs
+ * fewer octaves per pixel, so coarse levels cost little, and a chain starting at a coarse level
+ * never evaluates the fine ones. This applies to level 0 as well, so it only equals
+ * render_noise_map() for generators without such an overload. Those are sampled at the pixel
+ * centers of each level, through fill_grid_tile() if they provide fill_grid().
+ *
+ *          The tiles of all levels are distributed over the threads of the pool together, so
+ * coarse levels are rendered alongside the fine ones. The result doesn't depend on the tile size
+ * or the number of threads.
+ *
+ * @tparam TileSize Edge length of a tile in pixels
+ * @tparam Gen      Two-dimensional noise generator
+ * @tparam RandomIt Random access iterator accepting Gen::result_t
+ * @param pool      Thread pool to render on
+ * @param gen       Noise generator to evaluate
+ * @param origin    Point corresponding to the pixel at (0, 0) of level 0
+ * @param step      Distance between adjacent pixels of level 0
+ * @param chain     Layout of the levels
+ * @param out       Destination of the chain.size() values of all levels
+ * @param tolerance Weight of octaves that may be dropped, see fractal_noise_generator
+ */
+template<int TileSize = 64, class Gen, class RandomIt>
+void render_noise_pyramid(thread_pool& pool,
+                          Gen const& gen,
+                          point2d<typename Gen::result_t> const& origin,
+                          vec2d<typename Gen::result_t> const& step,
+                          mip_chain const& chain,
+                          RandomIt out,
+                          typename Gen::result_t tolerance = 0)
+{
+    static_assert(Gen::dimensions == 2, "Must use a 2D generator");
+    static_assert(TileSize > 0, "Tiles must not be empty");
+
+    using result_t = typename Gen::result_t;
+
+    // Index of the first tile of every level of the chain, followed by the total number of tiles
+    std::array<std::size_t, mip_chain::max_levels + 1> firstTiles{};
+    std::array<int, mip_chain::max_levels> tilesX{};
+    for (int i = 0; i < chain.num_levels(); ++i)
+    {
+        auto const& extents = chain.extents(chain.first_level() + i);
+        tilesX[i] = (extents[0] + TileSize - 1) / TileSize;
+        int const tilesY = (extents[1] + TileSize - 1) / TileSize;
+        firstTiles[i + 1] = firstTiles[i] + static_cast<std::size_t>(tilesX[i]) * tilesY;
+    }
+
+    auto const numTiles = firstTiles[chain.num_levels()];
+    pool.parallel_for(numTiles, [&](std::size_t tile) {
+        int const i = static_cast<int>(
+            std::upper_bound(firstTiles.begin() + 1, firstTiles.begin() + chain.num_levels(), tile)
+            - (firstTiles.begin() + 1));
+        int const level = chain.first_level() + i;
+        auto const levelTile = tile - firstTiles[i];
+        auto const& extents = chain.extents(level);
+        point2d_i const tileFirst{static_cast<int>(levelTile % tilesX[i]) * TileSize,
+                                  static_cast<int>(levelTile / tilesX[i]) * TileSize};
+        point2d_i const tileExtents{std::min(TileSize, extents[0] - tileFirst[0]),
+                                    std::min(TileSize, extents[1] - tileFirst[1])};
+
+        // A pixel of the level spans scale pixels of level 0 along each axis
+        auto const scale = std::ldexp(result_t{1}, level);
+        point2d<result_t> levelOrigin;
+        vec2d<result_t> levelStep;
+        for (int d = 0; d < 2; ++d)
+        {
+            levelOrigin[d] = origin[d] + (scale - 1) / 2 * step[d];
+            levelStep[d] = step[d] * scale;
+        }
+
+        auto const levelOut = out + static_cast<std::ptrdiff_t>(chain.offset(level));
+        if constexpr (has_fill_grid_v<Gen> && !has_footprint_at_v<Gen>)
+        {
+            fill_grid_tile<TileSize>(
+                gen,
+                levelOrigin,
+                levelStep,
+                tileFirst,
+                tileExtents,
+                levelOut + (static_cast<std::ptrdiff_t>(tileFirst[1]) * extents[0] + tileFirst[0]),
+                extents[0],
+                [](result_t value) { return value; });
+        }
+        else
+        {
+            auto const footprint = std::max(std::abs(levelStep[0]), std::abs(levelStep[1]));
+            for (int y = tileFirst[1]; y < tileFirst[1] + tileExtents[1]; ++y)
+            {
+                auto const yPos = levelOrigin[1] + static_cast<result_t>(y) * levelStep[1];
+                auto rowOut = levelOut
+                              + (static_cast<std::ptrdiff_t>(y) * extents[0] + tileFirst[0]);
+                for (int x = tileFirst[0]; x < tileFirst[0] + tileExtents[0]; ++x)
+                {
+                    point2d<result_t> const p{
+                        levelOrigin[0] + static_cast<result_t>(x) * levelStep[0], yPos};
+                    if constexpr (has_footprint_at_v<Gen>)
+                        *rowOut++ = gen.at(p, footprint, tolerance);
+                    else
+                        *rowOut++ = gen.at(p);
+                }
+            }
+        }
+    });
+}
+
+} // namespace noise
+
+#endif // PERLINNOISE_NOISE_PYRAMID_H
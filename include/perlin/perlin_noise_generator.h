@@ -5,14 +5,20 @@
 #ifndef PERLINNOISE_PERLIN_NOISE_GENERATOR_H
 #define PERLINNOISE_PERLIN_NOISE_GENERATOR_H
 
+#include "perlin/gradient_table.h"
+#include "perlin/hashed_gradients.h"
+#include "perlin/instrumentation.h"
 #include "perlin/math.h"
 #include "perlin/point.h"
+#include "perlin/random.h"
 #include "perlin/vector.h"
 
 #include <algorithm>
-#include <bitset>
+#include <cstdint>
 #include <numeric>
 #include <random>
+#include <utility>
+#include <vector>
 
 namespace noise
 {
@@ -30,14 +36,20 @@ namespace noise
  * @tparam Smoothness   Order of smoothstep function to use for interpolation
  * @tparam Result       Arithmetic result type
  * @tparam NumGradients Amount of random gradients to use. A larger number results in more
- * randomness, but longer computation times.
+ * randomness, but longer computation times. Powers of two are considerably faster to evaluate.
  * @tparam GridCoord    Integral grid coordinate type
+ * @tparam Gradients    Assignment of gradients to grid points, either gradient_table or
+ * hashed_gradients. The latter needs no memory besides a seed, see hashed_perlin_noise_generator.
+ * @tparam Instrumentation Policy counting evaluated samples, corners and gradient lookups, e.g.
+ * counting_instrumentation. The default no_instrumentation compiles to nothing.
  */
 template<int Dim,
          int Smoothness = 2,
          typename Result = float,
          int NumGradients = 256,
-         typename GridCoord = int>
+         typename GridCoord = int,
+         template<int, typename, int, typename> class Gradients = gradient_table,
+         class Instrumentation = no_instrumentation>
 class perlin_noise_generator
 {
   public:
@@ -49,6 +61,7 @@ class perlin_noise_generator
 
     using result_t = Result;
     using grid_coord_t = GridCoord;
+    using gradients_t = Gradients<Dim, Result, NumGradients, GridCoord>;
 
     static constexpr const int dimensions = Dim;
     static constexpr const int smoothness = Smoothness;
@@ -58,68 +71,453 @@ class perlin_noise_generator
      */
     template<class RndEngine = std::default_random_engine>
     explicit perlin_noise_generator(RndEngine&& rnd) noexcept
+        : m_gradients(std::forward<RndEngine>(rnd))
+    {
+    }
+
+    /**
+     * Construct the generator in a constant expression.
+     *
+     * @details A constexpr generator has its tables baked into read-only data and costs nothing at
+     * startup. The tables differ from the ones generated by a standard engine, but not between
+     * compile time and run time construction.
+     *
+     * @param rnd Random engine for noise generation
+     */
+    constexpr explicit perlin_noise_generator(splitmix64& rnd) noexcept
+        : m_gradients(rnd)
+    {
+    }
+
+    /**
+     * @param rnd Random engine for noise generation
+     */
+    constexpr explicit perlin_noise_generator(splitmix64&& rnd) noexcept
+        : m_gradients(rnd)
     {
-        std::iota(m_permutations.begin(), m_permutations.end(), result_t{0});
-        std::shuffle(m_permutations.begin(), m_permutations.end(), std::forward<RndEngine>(rnd));
-        std::generate(m_gradients.begin(), m_gradients.end(), [&]() {
-            return vector<result_t, Dim>::make_rand_unit_vec(std::forward<RndEngine>(rnd));
-        });
     }
 
     /**
      * Evaluate the noise function at a given point.
      *
+     * @details Can be evaluated in constant expressions.
+     *
      * @param p Point of evaluation
      * @return  Noise function value at the specified point
      */
-    result_t at(point<result_t, Dim> const& p) const noexcept
+    constexpr result_t at(point<result_t, Dim> const& p) const noexcept
+    {
+        point<grid_coord_t, Dim> baseGridPoint;
+        std::array<std::array<result_t, 2>, Dim> offsets{};
+        for (int d = 0; d < Dim; ++d)
+        {
+            baseGridPoint[d] = constexpr_floor<grid_coord_t>(p[d]);
+            offsets[d][0] = p[d] - static_cast<result_t>(baseGridPoint[d]);
+            offsets[d][1] = p[d] - static_cast<result_t>(baseGridPoint[d] + 1);
+        }
+
+        return at_cell(baseGridPoint, offsets);
+    }
+
+    /**
+     * Evaluate the noise function at a point given as lattice cell and offset within the cell.
+     *
+     * @details The point is cell + frac. Far away from the origin, absolute coordinates lose the
+     * precision of the offset, e.g. a float has no fractional bits left beyond 2^23. Passing both
+     * parts separately keeps the full precision of result_t for the offset, wherever the cell is.
+     * Wherever cell + frac is exactly representable, the result is identical to at(cell + frac).
+     *
+     * @param cell Integral lattice cell
+     * @param frac Offset within the cell, usually in [0, 1)
+     * @return     Noise function value at the specified point
+     */
+    constexpr result_t at(point<grid_coord_t, Dim> const& cell,
+                          point<result_t, Dim> const& frac) const noexcept
     {
-        // Compute neighboring grid points
-        constexpr int const NumNeighbors = ipow(2, Dim);
+        point<grid_coord_t, Dim> baseGridPoint;
+        std::array<std::array<result_t, 2>, Dim> offsets{};
+        for (int d = 0; d < Dim; ++d)
+        {
+            auto const carry = constexpr_floor<grid_coord_t>(frac[d]);
+            baseGridPoint[d] = cell[d] + carry;
+            offsets[d][0] = frac[d] - static_cast<result_t>(carry);
+            offsets[d][1] = frac[d] - static_cast<result_t>(carry + 1);
+        }
+
+        return at_cell(baseGridPoint, offsets);
+    }
+
+    /**
+     * Evaluate the noise function and its gradient at a given point.
+     *
+     * @details The gradient is computed analytically by differentiating the dot products and the
+     * smoothstep interpolation, which is considerably cheaper than finite differences. The value is
+     * identical to the one returned by at(), including its clamping to [-1, 1]. Where the clamping
+     * takes effect, the gradient is zero, as is the derivative of the clamped function.
+     *
+     * @param p Point of evaluation
+     * @return  Noise function value and its partial derivatives at the specified point
+     */
+    value_and_gradient<result_t, Dim> at_with_gradient(point<result_t, Dim> const& p) const
+        noexcept
+    {
+        Instrumentation::count(counter::samples);
+        Instrumentation::count(counter::corners, s_numNeighbors);
+
         auto baseGridPoint = p.template floor<grid_coord_t>();
-        std::array<point<grid_coord_t, Dim>, NumNeighbors> m_nodes{};
-        std::generate(m_nodes.begin(), m_nodes.end(), [n = 0u, &baseGridPoint]() mutable {
-            std::bitset<Dim> bits(n++);
-            auto gridPoint = baseGridPoint;
-            for (unsigned d = 0; d < Dim; ++d)
-            {
-                if (bits.test(d))
-                    gridPoint[d]++;
-            }
-            return gridPoint;
-        });
-
-        // Vectors from neighboring grid nodes to point
-        std::array<vector<result_t, Dim>, NumNeighbors> m_nodeVecs;
-        std::transform(m_nodes.begin(),
-                       m_nodes.end(),
-                       m_nodeVecs.begin(),
-                       [&p](point<grid_coord_t, Dim> const& n) {
-                           return vector<result_t, Dim>::from_point(p)
-                                  - vector<result_t, Dim>::from_point(
-                                      n.template convert_to<result_t>());
-                       });
-
-        // Compute dot products between node vectors and gradients
-        std::array<result_t, NumNeighbors> dot_products{};
-        std::transform(m_nodes.begin(),
-                       m_nodes.end(),
-                       m_nodeVecs.begin(),
-                       dot_products.begin(),
-                       [this](point<grid_coord_t, Dim> const& n, vector<result_t, Dim> const& nv) {
-                           return dot(gradient_at(n), nv);
-                       });
+        auto const gradients = gradients_at(baseGridPoint);
 
-        // Interpolate dot products
-        int s = NumNeighbors;
+        // Dot products and their gradients, which are just the corner gradients
+        std::array<result_t, s_numNeighbors> dot_products{};
+        std::array<vector<result_t, Dim>, s_numNeighbors> derivatives{};
+        for (int n = 0; n < s_numNeighbors; ++n)
+        {
+            vector<result_t, Dim> nodeVec;
+            for (int d = 0; d < Dim; ++d)
+                nodeVec[d] = p[d] - static_cast<result_t>(baseGridPoint[d] + ((n >> d) & 1));
+            dot_products[n] = dot(gradients[n], nodeVec);
+            derivatives[n] = gradients[n];
+        }
+
+        // Interpolate dot products, applying the product rule to the interpolation weights
+        int s = s_numNeighbors;
+        for (int d = 0; d < Dim; ++d)
+        {
+            auto const offset = p[d] - baseGridPoint[d];
+            auto const weight = smoothstep<Smoothness>(offset);
+            auto const weightDerivative = smoothstep_derivative<Smoothness>(offset);
+            for (int i = 0; i < s; i += 2)
+            {
+                auto const diff = dot_products[i + 1] - dot_products[i];
+                derivatives[i / 2]
+                    = derivatives[i] + (derivatives[i + 1] - derivatives[i]) * weight;
+                derivatives[i / 2][d] += weightDerivative * diff;
+                dot_products[i / 2] = dot_products[i] + weight * diff;
+            }
+            s /= 2;
+        }
+
+        // Account for rounding errors. The clamped function is constant beyond the limits.
+        auto const value
+            = std::clamp(dot_products[0], static_cast<result_t>(-1), static_cast<result_t>(1));
+        if (value != dot_products[0])
+            return {value, vector<result_t, Dim>{}};
+        return {value, derivatives[0]};
+    }
+
+    /**
+     * Evaluate the noise function at multiple points.
+     *
+     * @details Points are processed in packs of s_packSize. Every step of the evaluation is done
+     * for the whole pack at once on structure-of-arrays data, which allows the compiler to map the
+     * pack onto SIMD lanes. The operations are performed in the same order as in at(), so the
+     * results are identical to evaluating every point on its own. Only if the compiler contracts
+     * multiplications and additions into FMA instructions (e.g. -march=native on x86), the two
+     * paths may round differently; results then differ by at most a few multiples of
+     * std::numeric_limits<result_t>::epsilon().
+     *
+     * @tparam InputIt  Input iterator over point<result_t, Dim>
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param first     Begin of the range of evaluation points
+     * @param last      End of the range of evaluation points
+     * @param out       Destination of the noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class InputIt, class OutputIt>
+    OutputIt at(InputIt first, InputIt last, OutputIt out) const noexcept
+    {
+        pack<result_t> coords{};
+        std::array<result_t, s_packSize> values{};
+        while (first != last)
+        {
+            int n = 0;
+            for (; n < s_packSize && first != last; ++n, ++first)
+            {
+                auto const& p = *first;
+                for (int d = 0; d < Dim; ++d)
+                    coords[d][n] = p[d];
+            }
+
+            // Unused lanes of the last pack keep their previous coordinates
+            at_pack(coords, values);
+            out = std::copy_n(values.begin(), n, out);
+
+            Instrumentation::count(counter::samples, n);
+            Instrumentation::count(counter::corners, n * s_numNeighbors);
+            Instrumentation::count(counter::gradient_lookups, n * s_numNeighbors);
+        }
+        return out;
+    }
+
+    /**
+     * Evaluate the noise function on a regular grid of points.
+     *
+     * @details The grid spans the points origin + i * step for all 0 <= i < extents, where the
+     * index i is taken element-wise. Values are written in row-major order, with the first
+     * dimension varying fastest.
+     *
+     *          Lattice cells, offsets and interpolation weights are computed once per grid line
+     * instead of once per sample, and gradients are only looked up when the walk along the first
+     * dimension enters a new lattice cell. The results are identical to calling at() on every
+     * point.
+     *
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param origin    First point of the grid
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param extents   Number of grid points along each dimension
+     * @param out       Destination of the prod(extents) noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class OutputIt>
+    OutputIt fill_grid(point<result_t, Dim> const& origin,
+                       vector<result_t, Dim> const& step,
+                       point<int, Dim> const& extents,
+                       OutputIt out) const
+    {
+        return fill_grid(origin, step, point<int, Dim>{}, extents, out);
+    }
+
+    /**
+     * Evaluate the noise function on a section of a regular grid of points.
+     *
+     * @details Like fill_grid(origin, step, extents, out), but only evaluates the points
+     * origin + i * step for first <= i < first + extents. Splitting a grid into sections yields
+     * exactly the same values as evaluating it at once.
+     *
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param origin    Point of the grid at index 0
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param first     Index of the first grid point of the section
+     * @param extents   Number of grid points of the section along each dimension
+     * @param out       Destination of the prod(extents) noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class OutputIt>
+    OutputIt fill_grid(point<result_t, Dim> const& origin,
+                       vector<result_t, Dim> const& step,
+                       point<int, Dim> const& first,
+                       point<int, Dim> const& extents,
+                       OutputIt out) const
+    {
+        if (std::any_of(extents.begin(), extents.end(), [](int e) { return e <= 0; }))
+            return out;
+
+        if constexpr (Instrumentation::enabled)
+        {
+            std::uint64_t samples = 1;
+            for (int d = 0; d < Dim; ++d)
+                samples *= static_cast<std::uint64_t>(extents[d]);
+            Instrumentation::count(counter::grids);
+            Instrumentation::count(counter::samples, samples);
+            Instrumentation::count(counter::corners, samples * s_numNeighbors);
+        }
+
+        // The lattice position along one axis doesn't depend on the other axes
+        std::array<std::vector<axis_sample>, Dim> axes;
+        for (int d = 0; d < Dim; ++d)
+        {
+            axes[d].resize(extents[d]);
+            for (int i = 0; i < extents[d]; ++i)
+            {
+                axes[d][i] = axis_sample::make(origin[d]
+                                               + static_cast<result_t>(first[d] + i) * step[d]);
+            }
+        }
+
+        std::array<int, Dim> idx{};
+        std::array<vector<result_t, Dim>, s_numNeighbors> gradients{};
+        std::array<result_t, s_numNeighbors> dot_products{};
+        std::array<result_t, Dim> weights{};
+        do
+        {
+            for (int d = 1; d < Dim; ++d)
+                weights[d] = axes[d][idx[d]].weight;
+
+            for (int i = 0; i < extents[0]; ++i)
+            {
+                idx[0] = i;
+                weights[0] = axes[0][i].weight;
+
+                if (i == 0 || axes[0][i].cell != axes[0][i - 1].cell)
+                {
+                    point<grid_coord_t, Dim> baseGridPoint;
+                    for (int d = 0; d < Dim; ++d)
+                        baseGridPoint[d] = axes[d][idx[d]].cell;
+                    gradients = gradients_at(baseGridPoint);
+                }
+
+                for (int n = 0; n < s_numNeighbors; ++n)
+                {
+                    result_t dp = 0;
+                    for (int d = 0; d < Dim; ++d)
+                        dp = dp + gradients[n][d] * axes[d][idx[d]].offsets[(n >> d) & 1];
+                    dot_products[n] = dp;
+                }
+
+                *out++ = interpolate(dot_products, weights);
+            }
+        } while (next_row(idx, extents));
+
+        return out;
+    }
+
+    /**
+     * Evaluate the noise function on a section of a regular 3d grid, writing to a strided volume.
+     *
+     * @details Evaluates the same points as fill_grid(origin, step, first, extents, out) and gives
+     * identical results, but writes the value of the grid index first + (i, j, k) to
+     * out[i * strides[0] + j * strides[1] + k * strides[2]], see fill_volume(coords, out, strides).
+     *
+     * @tparam RandomIt Random access iterator accepting result_t
+     * @param origin    Point of the grid at index 0
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param first     Index of the first grid point of the section
+     * @param extents   Number of grid points of the section along each dimension
+     * @param out       Destination of the noise values
+     * @param strides   Distance in elements between adjacent values along each dimension
+     */
+    template<class RandomIt>
+    void fill_volume(point<result_t, Dim> const& origin,
+                     vector<result_t, Dim> const& step,
+                     point<int, Dim> const& first,
+                     point<int, Dim> const& extents,
+                     RandomIt out,
+                     std::array<std::ptrdiff_t, Dim> const& strides) const
+    {
+        std::array<std::vector<result_t>, Dim> coords;
+        for (int d = 0; d < Dim; ++d)
+        {
+            coords[d].resize(std::max(extents[d], 0));
+            for (int i = 0; i < extents[d]; ++i)
+                coords[d][i] = origin[d] + static_cast<result_t>(first[d] + i) * step[d];
+        }
+        fill_volume(coords, out, strides);
+    }
+
+    /**
+     * Evaluate the noise function on a 3d rectilinear grid, writing to a strided volume.
+     *
+     * @details Evaluates the points (coords[0][i], coords[1][j], coords[2][k]) and writes them to
+     * out[i * strides[0] + j * strides[1] + k * strides[2]]. The coordinates along each axis
+     * don't need to be equally spaced.
+     *
+     *          The grid is traversed one block of points sharing a lattice cell at a time, so the
+     * gradients at the corners of a cell are looked up once per cell instead of once per point.
+     * Products of gradients and offsets along the outer axes are computed once per plane and row
+     * of a block. The operations are performed in the same order as in at(), so the results are
+     * identical to calling at() on every point.
+     *
+     * @tparam RandomIt Random access iterator accepting result_t
+     * @param coords    Coordinates of the grid lines along each dimension
+     * @param out       Destination of the noise values
+     * @param strides   Distance in elements between adjacent values along each dimension
+     */
+    template<class RandomIt>
+    void fill_volume(std::array<std::vector<result_t>, Dim> const& coords,
+                     RandomIt out,
+                     std::array<std::ptrdiff_t, Dim> const& strides) const
+    {
+        static_assert(Dim == 3, "Volumes can only be filled by 3D generators");
+
+        // Lattice data per grid line, and runs of grid lines within the same lattice cell
+        std::array<std::vector<axis_sample>, Dim> axes;
+        std::array<std::vector<std::size_t>, Dim> runs;
+        for (int d = 0; d < Dim; ++d)
+        {
+            if (coords[d].empty())
+                return;
+            axes[d].resize(coords[d].size());
+            std::transform(coords[d].begin(), coords[d].end(), axes[d].begin(), axis_sample::make);
+            for (std::size_t i = 0; i < axes[d].size(); ++i)
+            {
+                if (i == 0 || axes[d][i].cell != axes[d][i - 1].cell)
+                    runs[d].push_back(i);
+            }
+            runs[d].push_back(axes[d].size());
+        }
+
+        if constexpr (Instrumentation::enabled)
+        {
+            auto const samples = static_cast<std::uint64_t>(coords[0].size() * coords[1].size()
+                                                            * coords[2].size());
+            Instrumentation::count(counter::grids);
+            Instrumentation::count(counter::samples, samples);
+            Instrumentation::count(counter::corners, samples * s_numNeighbors);
+        }
+
+        using run = std::pair<std::size_t, std::size_t>;
+        for (std::size_t rz = 0; rz + 1 < runs[2].size(); ++rz)
+        {
+            for (std::size_t ry = 0; ry + 1 < runs[1].size(); ++ry)
+            {
+                for (std::size_t rx = 0; rx + 1 < runs[0].size(); ++rx)
+                {
+                    fill_volume_block(axes,
+                                      {run{runs[0][rx], runs[0][rx + 1]},
+                                       run{runs[1][ry], runs[1][ry + 1]},
+                                       run{runs[2][rz], runs[2][rz + 1]}},
+                                      out,
+                                      strides);
+                }
+            }
+        }
+    }
+
+    /**
+     * @return Assignment of gradients to grid points, e.g. to save it with save_gradient_table()
+     */
+    constexpr gradients_t const& gradients() const noexcept { return m_gradients; }
+
+  private:
+    // Caches per-sample lattice data across frames and needs the corner gradients for that
+    template<class Gen>
+    friend class animated_noise_field;
+
+    static constexpr const int s_numNeighbors = ipow(2, Dim);
+    static constexpr const int s_packSize = 8;
+
+    template<typename T>
+    using pack = std::array<std::array<T, s_packSize>, Dim>;
+
+    /**
+     * Lattice data of a single coordinate along one axis
+     */
+    struct axis_sample
+    {
+        grid_coord_t cell;
+        std::array<result_t, 2> offsets; // Offsets from the lower and upper cell boundary
+        result_t weight;                 // Interpolation weight of the upper cell boundary
+
+        static axis_sample make(result_t coord) noexcept
+        {
+            auto const cell = static_cast<grid_coord_t>(std::floor(coord));
+            return {cell,
+                    {coord - static_cast<result_t>(cell), coord - static_cast<result_t>(cell + 1)},
+                    smoothstep<Smoothness>(coord - cell)};
+        }
+    };
+
+    gradients_t m_gradients;
+
+    /**
+     * Interpolate the dot products at the corners of a lattice cell
+     *
+     * @param dot_products Dot products at the cell corners, the n-th corner being offset by one
+     * along every dimension d where bit d of n is set
+     * @param weights      Smoothed interpolation weights along every dimension
+     * @return             Interpolated value
+     */
+    static constexpr result_t interpolate(std::array<result_t, s_numNeighbors> dot_products,
+                                          std::array<result_t, Dim> const& weights) noexcept
+    {
+        int s = s_numNeighbors;
         for (int d = 0; d < Dim; ++d)
         {
             // Iterate neighbors
             for (int i = 0; i < s; i += 2)
             {
-                dot_products[i / 2] = dot_products[i]
-                                      + smoothstep<Smoothness>(p[d] - baseGridPoint[d])
-                                            * (dot_products[i + 1] - dot_products[i]);
+                dot_products[i / 2]
+                    = dot_products[i] + weights[d] * (dot_products[i + 1] - dot_products[i]);
             }
             s /= 2;
         }
@@ -128,21 +526,275 @@ class perlin_noise_generator
         return std::clamp(dot_products[0], static_cast<result_t>(-1), static_cast<result_t>(1));
     }
 
-  private:
-    std::array<int, NumGradients> m_permutations{};
-    std::array<vector<result_t, Dim>, NumGradients> m_gradients{};
-
-    constexpr vector<result_t, Dim> const& gradient_at(point<grid_coord_t, Dim> const& point) const
+    /**
+     * Evaluate the noise function within a lattice cell
+     *
+     * @param baseGridPoint Lowest corner of the cell
+     * @param offsets       Offsets of the point from the lower and upper cell boundary along every
+     * dimension
+     * @return              Noise function value
+     */
+    constexpr result_t at_cell(point<grid_coord_t, Dim> const& baseGridPoint,
+                               std::array<std::array<result_t, 2>, Dim> const& offsets) const
         noexcept
     {
-        grid_coord_t idx = mod(point[Dim - 1], NumGradients);
-        for (int i = Dim - 2; i >= 0; --i)
-            idx = mod((point[i] + m_permutations[idx]), NumGradients);
+        Instrumentation::count(counter::samples);
+        Instrumentation::count(counter::corners, s_numNeighbors);
+        Instrumentation::count(counter::gradient_lookups, s_numNeighbors);
+
+        // Compute dot products between gradients and vectors from neighboring grid nodes to point
+        std::array<result_t, s_numNeighbors> dot_products{};
+        for (int n = 0; n < s_numNeighbors; ++n)
+        {
+            auto gridPoint = baseGridPoint;
+            vector<result_t, Dim> nodeVec;
+            for (int d = 0; d < Dim; ++d)
+            {
+                auto const upper = (n >> d) & 1;
+                gridPoint[d] += upper;
+                nodeVec[d] = offsets[d][upper];
+            }
+            dot_products[n] = dot(m_gradients.at(gridPoint), nodeVec);
+        }
+
+        // Interpolate dot products
+        std::array<result_t, Dim> weights{};
+        for (int d = 0; d < Dim; ++d)
+            weights[d] = smoothstep<Smoothness>(offsets[d][0]);
+
+        return interpolate(dot_products, weights);
+    }
+
+    /**
+     * Evaluate the noise function at a pack of points
+     *
+     * @param coords Coordinates of the points, one lane per point
+     * @param values Noise values, one lane per point
+     */
+    void at_pack(pack<result_t> const& coords,
+                 std::array<result_t, s_packSize>& values) const noexcept
+    {
+        pack<grid_coord_t> cells;
+        pack<result_t> offsets;
+        pack<result_t> weights;
+        for (int d = 0; d < Dim; ++d)
+        {
+            for (int l = 0; l < s_packSize; ++l)
+            {
+                cells[d][l] = constexpr_floor<grid_coord_t>(coords[d][l]);
+                offsets[d][l] = coords[d][l] - static_cast<result_t>(cells[d][l]);
+                weights[d][l] = smoothstep<Smoothness>(coords[d][l] - cells[d][l]);
+            }
+        }
+
+        // Reduce the cells once, so that table lookups only need to wrap around sums of reduced
+        // values. Hashed gradients take the cells as they are.
+        pack<grid_coord_t> reducedCells = cells;
+        if constexpr (!gradients_t::is_hashed)
+        {
+            for (int d = 0; d < Dim; ++d)
+            {
+                for (int l = 0; l < s_packSize; ++l)
+                    reducedCells[d][l] = reduce_grid_coord<gradients_t::size>(cells[d][l]);
+            }
+        }
+
+        std::array<std::array<result_t, s_packSize>, s_numNeighbors> dot_products;
+        pack<result_t> gradients;
+        for (int n = 0; n < s_numNeighbors; ++n)
+        {
+            corner_gradients(reducedCells, n, gradients);
+
+            auto& dp = dot_products[n];
+            dp.fill(0);
+            for (int d = 0; d < Dim; ++d)
+            {
+                // Vector from the corner to the point
+                std::array<result_t, s_packSize> nodeVec;
+                for (int l = 0; l < s_packSize; ++l)
+                {
+                    nodeVec[l] = ((n >> d) & 1)
+                                     ? coords[d][l] - static_cast<result_t>(cells[d][l] + 1)
+                                     : offsets[d][l];
+                }
+                for (int l = 0; l < s_packSize; ++l)
+                    dp[l] = dp[l] + gradients[d][l] * nodeVec[l];
+            }
+        }
+
+        // Interpolate dot products
+        int s = s_numNeighbors;
+        for (int d = 0; d < Dim; ++d)
+        {
+            for (int i = 0; i < s; i += 2)
+            {
+                for (int l = 0; l < s_packSize; ++l)
+                {
+                    dot_products[i / 2][l]
+                        = dot_products[i][l]
+                          + weights[d][l] * (dot_products[i + 1][l] - dot_products[i][l]);
+                }
+            }
+            s /= 2;
+        }
+
+        // Account for rounding errors
+        for (int l = 0; l < s_packSize; ++l)
+        {
+            values[l] = std::clamp(
+                dot_products[0][l], static_cast<result_t>(-1), static_cast<result_t>(1));
+        }
+    }
+
+    /**
+     * Compute the gradients at a corner of the lattice cells of a pack of points
+     *
+     * @param cells     Lowest corners of the cells, reduced modulo the table size for gradient
+     * tables
+     * @param n         Corner, offset by one along every dimension d where bit d of n is set
+     * @param gradients Gradients at the corners, one lane per point
+     */
+    void corner_gradients(pack<grid_coord_t> const& cells,
+                          int n,
+                          pack<result_t>& gradients) const noexcept
+    {
+        if constexpr (gradients_t::is_hashed)
+        {
+            // Same hashing as in hashed_gradients::at(), lane by lane without any memory access
+            std::array<std::uint32_t, s_packSize> hash;
+            hash.fill(m_gradients.seed());
+            for (int d = 0; d < Dim; ++d)
+            {
+                for (int l = 0; l < s_packSize; ++l)
+                    hash[l] = gradients_t::combine(hash[l], cells[d][l] + ((n >> d) & 1));
+            }
+            for (int l = 0; l < s_packSize; ++l)
+                hash[l] = gradients_t::finalize(hash[l]);
+
+            for (int d = 0; d < Dim; ++d)
+            {
+                for (int l = 0; l < s_packSize; ++l)
+                    gradients[d][l] = gradients_t::component(hash[l], d);
+            }
+        }
+        else
+        {
+            std::array<grid_coord_t, s_packSize> idx;
+            gradient_indices<gradients_t::size>(m_gradients.permutations(), cells, n, idx);
 
-        return m_gradients[idx];
+            for (int d = 0; d < Dim; ++d)
+            {
+                for (int l = 0; l < s_packSize; ++l)
+                    gradients[d][l] = m_gradients.gradient(idx[l])[d];
+            }
+        }
+    }
+
+    /**
+     * Evaluate a block of a rectilinear 3d grid whose points all lie in the same lattice cell
+     *
+     * @param axes    Lattice data of the grid lines along each dimension
+     * @param block   Begin and end of the grid lines of the block along each dimension
+     * @param out     Destination of the noise values
+     * @param strides Distance in elements between adjacent values along each dimension
+     */
+    template<class RandomIt>
+    void fill_volume_block(std::array<std::vector<axis_sample>, Dim> const& axes,
+                           std::array<std::pair<std::size_t, std::size_t>, Dim> const& block,
+                           RandomIt out,
+                           std::array<std::ptrdiff_t, Dim> const& strides) const noexcept
+    {
+        auto const gradients = gradients_at(point<grid_coord_t, Dim>{axes[0][block[0].first].cell,
+                                                                     axes[1][block[1].first].cell,
+                                                                     axes[2][block[2].first].cell});
+
+        std::array<result_t, s_numNeighbors> zProducts;
+        std::array<result_t, s_numNeighbors> yProducts;
+        std::array<result_t, s_numNeighbors> dot_products;
+        for (std::size_t k = block[2].first; k < block[2].second; ++k)
+        {
+            auto const& z = axes[2][k];
+            for (int n = 0; n < s_numNeighbors; ++n)
+                zProducts[n] = gradients[n][2] * z.offsets[(n >> 2) & 1];
+
+            for (std::size_t j = block[1].first; j < block[1].second; ++j)
+            {
+                auto const& y = axes[1][j];
+                for (int n = 0; n < s_numNeighbors; ++n)
+                    yProducts[n] = gradients[n][1] * y.offsets[(n >> 1) & 1];
+
+                auto const rowOut = out
+                                    + (static_cast<std::ptrdiff_t>(k) * strides[2]
+                                       + static_cast<std::ptrdiff_t>(j) * strides[1]);
+                for (std::size_t i = block[0].first; i < block[0].second; ++i)
+                {
+                    auto const& x = axes[0][i];
+                    for (int n = 0; n < s_numNeighbors; ++n)
+                    {
+                        // Same summation order as dot() in at()
+                        result_t dp = 0;
+                        dp = dp + gradients[n][0] * x.offsets[n & 1];
+                        dot_products[n] = (dp + yProducts[n]) + zProducts[n];
+                    }
+                    rowOut[static_cast<std::ptrdiff_t>(i) * strides[0]]
+                        = interpolate(dot_products, {x.weight, y.weight, z.weight});
+                }
+            }
+        }
+    }
+
+    /**
+     * Advance a grid index to the next row, i.e. increment all but the first dimension
+     *
+     * @return false if there is no next row
+     */
+    static constexpr bool next_row(std::array<int, Dim>& idx,
+                                   point<int, Dim> const& extents) noexcept
+    {
+        for (int d = 1; d < Dim; ++d)
+        {
+            if (++idx[d] < extents[d])
+                return true;
+            idx[d] = 0;
+        }
+        return false;
+    }
+
+    /**
+     * Look up the gradients at all corners of a lattice cell
+     *
+     * @param baseGridPoint Lowest corner of the cell
+     * @return              Gradients, ordered like the dot products passed to interpolate()
+     */
+    std::array<vector<result_t, Dim>, s_numNeighbors> gradients_at(
+        point<grid_coord_t, Dim> const& baseGridPoint) const noexcept
+    {
+        Instrumentation::count(counter::gradient_lookups, s_numNeighbors);
+
+        std::array<vector<result_t, Dim>, s_numNeighbors> gradients{};
+        for (int n = 0; n < s_numNeighbors; ++n)
+        {
+            auto gridPoint = baseGridPoint;
+            for (int d = 0; d < Dim; ++d)
+                gridPoint[d] += (n >> d) & 1;
+            gradients[n] = m_gradients.at(gridPoint);
+        }
+        return gradients;
     }
 };
 
+/**
+ * Perlin noise with table-free gradients, which only needs memory for a seed
+ *
+ * @tparam Dim        Dimensionality of the noise function
+ * @tparam Smoothness Order of smoothstep function to use for interpolation
+ * @tparam Result     Arithmetic result type
+ * @tparam GridCoord  Integral grid coordinate type
+ */
+template<int Dim, int Smoothness = 2, typename Result = float, typename GridCoord = int>
+using hashed_perlin_noise_generator
+    = perlin_noise_generator<Dim, Smoothness, Result, 256, GridCoord, hashed_gradients>;
+
 } // namespace noise
 
 #endif // PERLINNOISE_PERLIN_NOISE_GENERATOR_H
@@ -28,7 +28,9 @@ class point
     constexpr point(point const&) noexcept = default;
     constexpr point(point&&) noexcept = default;
 
-    template<typename... U>
+    // Constrained so that it doesn't hijack copy construction from non-const points
+    template<typename... U,
+             typename = std::enable_if_t<(std::is_arithmetic_v<std::decay_t<U>> && ...)>>
     constexpr explicit point(U&&... u)
         : m_elems{{std::forward<U>(u)...}}
     {
@@ -39,8 +41,11 @@ class point
     constexpr point& operator=(point const&) noexcept = default;
     constexpr point& operator=(point&&) noexcept = default;
 
-    constexpr bool operator==(point const& other) noexcept { return m_elems == other.m_elems; }
-    constexpr bool operator!=(point const& other) noexcept { return !(*this == other); }
+    constexpr bool operator==(point const& other) const noexcept
+    {
+        return m_elems == other.m_elems;
+    }
+    constexpr bool operator!=(point const& other) const noexcept { return !(*this == other); }
 
     constexpr T const& operator[](std::size_t i) const noexcept { return m_elems[i]; }
     constexpr T& operator[](std::size_t i) noexcept { return m_elems[i]; }
@@ -0,0 +1,243 @@
+/**********************************************************
+ * @file   quantize.h
+ * @author jan
+ * @date   7/27/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_QUANTIZE_H
+#define PERLINNOISE_QUANTIZE_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace noise
+{
+/**
+ * Convert a float to the bit pattern of the closest IEEE 754 half precision number
+ *
+ * @details Rounds to nearest even. Values beyond the half range become infinity, NaNs stay NaNs.
+ * @param x Any float
+ * @return  Bit pattern of the half precision number
+ */
+inline std::uint16_t float_to_half(float x) noexcept
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+
+    auto const sign = static_cast<std::uint32_t>((bits >> 16) & 0x8000u);
+    auto const exponent = static_cast<int>((bits >> 23) & 0xffu);
+    std::uint32_t mantissa = bits & 0x7fffffu;
+
+    if (exponent == 0xff) // Infinity or NaN
+        return static_cast<std::uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+
+    int const halfExponent = exponent - 127 + 15;
+    if (halfExponent >= 0x1f) // Overflow
+        return static_cast<std::uint16_t>(sign | 0x7c00u);
+
+    // Number of mantissa bits to drop, more for subnormal results
+    int shift = 13;
+    std::uint32_t half = 0;
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10) // Rounds to zero
+            return static_cast<std::uint16_t>(sign);
+        mantissa |= 0x800000u;
+        shift = 14 - halfExponent;
+    }
+    else
+        half = static_cast<std::uint32_t>(halfExponent) << 10;
+
+    // A carry out of the mantissa correctly increments the exponent
+    half += mantissa >> shift;
+    std::uint32_t const remainder = mantissa & ((1u << shift) - 1);
+    std::uint32_t const halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1u) != 0))
+        ++half;
+    return static_cast<std::uint16_t>(sign | half);
+}
+
+/**
+ * Convert the bit pattern of an IEEE 754 half precision number to float
+ * @param h Bit pattern of the half precision number
+ * @return  The same number as float
+ */
+inline float half_to_float(std::uint16_t h) noexcept
+{
+    std::uint32_t const sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+    int exponent = (h >> 10) & 0x1f;
+    std::uint32_t mantissa = h & 0x3ffu;
+
+    std::uint32_t bits;
+    if (exponent == 0x1f) // Infinity or NaN
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+            bits = sign;
+        else
+        {
+            // Normalize the subnormal number
+            exponent = 1;
+            while ((mantissa & 0x400u) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | static_cast<std::uint32_t>(exponent - 15 + 127) << 23
+                   | (mantissa & 0x3ffu) << 13;
+        }
+    }
+    else
+        bits = sign | static_cast<std::uint32_t>(exponent - 15 + 127) << 23 | mantissa << 13;
+
+    float x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/**
+ * Unsigned normalized integer format: [0, 1] is mapped linearly to [0, m], where m is the largest
+ * value of the storage type
+ * @tparam Storage Unsigned integer type
+ */
+template<typename Storage>
+struct unorm
+{
+    static_assert(std::is_unsigned_v<Storage>, "Storage must be an unsigned integer type");
+
+    using storage_t = Storage;
+
+    static constexpr float const lowest = 0.f;
+    static constexpr float const highest = 1.f;
+
+    /**
+     * @param x Value to encode, clamped to [0, 1]. NaN is encoded as 0.
+     * @return  Closest representable value
+     */
+    static constexpr storage_t encode(float x) noexcept
+    {
+        constexpr float const max = static_cast<float>(std::numeric_limits<Storage>::max());
+        x = x > 0.f ? (x < 1.f ? x : 1.f) : 0.f;
+        return static_cast<storage_t>(x * max + 0.5f);
+    }
+};
+
+/**
+ * Signed normalized integer format: [-1, 1] is mapped linearly to [-m, m], where m is the largest
+ * value of the storage type
+ * @tparam Storage Signed integer type
+ */
+template<typename Storage>
+struct snorm
+{
+    static_assert(std::is_signed_v<Storage> && std::is_integral_v<Storage>,
+                  "Storage must be a signed integer type");
+
+    using storage_t = Storage;
+
+    static constexpr float const lowest = -1.f;
+    static constexpr float const highest = 1.f;
+
+    /**
+     * @param x Value to encode, clamped to [-1, 1]. NaN is encoded as 0.
+     * @return  Closest representable value
+     */
+    static constexpr storage_t encode(float x) noexcept
+    {
+        constexpr float const max = static_cast<float>(std::numeric_limits<Storage>::max());
+        x = x > -1.f ? (x < 1.f ? x : 1.f) : (x <= -1.f ? -1.f : 0.f);
+        return static_cast<storage_t>(x * max + (x < 0.f ? -0.5f : 0.5f));
+    }
+};
+
+/**
+ * IEEE 754 half precision format, stored as its bit pattern
+ */
+struct half
+{
+    using storage_t = std::uint16_t;
+
+    static constexpr float const lowest = -1.f;
+    static constexpr float const highest = 1.f;
+
+    /**
+     * @param x Value to encode
+     * @return  Bit pattern of the closest half precision number
+     */
+    static storage_t encode(float x) noexcept { return float_to_half(x); }
+};
+
+using unorm8 = unorm<std::uint8_t>;
+using unorm16 = unorm<std::uint16_t>;
+using snorm8 = snorm<std::int8_t>;
+using snorm16 = snorm<std::int16_t>;
+
+/**
+ * Maps noise values to a storage format by value * scale + bias
+ *
+ * @details The default quantizer maps the noise range [-1, 1] to the normalized range of the
+ * format, i.e. [0, 1] for unorm and [-1, 1] for snorm and half.
+ *
+ * @tparam Format Storage format, e.g. unorm8, unorm16, snorm8, snorm16 or half
+ * @tparam T      Noise value type
+ */
+template<class Format, typename T = float>
+class quantizer
+{
+  public:
+    using storage_t = typename Format::storage_t;
+
+    /**
+     * Construct a quantizer mapping [-1, 1] to the normalized range of the format
+     */
+    constexpr quantizer() noexcept
+        : quantizer(from_range(T{-1}, T{1}))
+    {
+    }
+
+    /**
+     * @param scale Factor applied to noise values
+     * @param bias  Offset added to scaled noise values
+     */
+    constexpr quantizer(T scale, T bias) noexcept
+        : m_scale(scale)
+        , m_bias(bias)
+    {
+    }
+
+    /**
+     * @param min Noise value mapped to the lowest normalized value of the format
+     * @param max Noise value mapped to the highest normalized value of the format
+     * @return    Quantizer mapping [min, max] linearly to the normalized range of the format
+     */
+    static constexpr quantizer from_range(T min, T max) noexcept
+    {
+        T const scale = static_cast<T>(Format::highest - Format::lowest) / (max - min);
+        return quantizer(scale, static_cast<T>(Format::lowest) - min * scale);
+    }
+
+    /**
+     * @param value Noise value
+     * @return      Quantized value
+     */
+    storage_t operator()(T value) const noexcept
+    {
+        return Format::encode(static_cast<float>(value * m_scale + m_bias));
+    }
+
+    T scale() const noexcept { return m_scale; }
+    T bias() const noexcept { return m_bias; }
+
+  private:
+    T m_scale;
+    T m_bias;
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_QUANTIZE_H
@@ -0,0 +1,105 @@
+/**********************************************************
+ * @file   random.h
+ * @author jan
+ * @date   7/24/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_RANDOM_H
+#define PERLINNOISE_RANDOM_H
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace noise
+{
+/**
+ * Pseudo-random number generator that can be used in constant expressions.
+ *
+ * @details Implements SplitMix64, which passes common statistical test suites and only needs a
+ * single 64 bit integer of state. It satisfies the UniformRandomBitGenerator requirements, but the
+ * standard distributions can't be evaluated at compile time. Use constexpr_uniform_int() and
+ * constexpr_uniform_real() instead.
+ */
+class splitmix64
+{
+  public:
+    using result_type = std::uint64_t;
+
+    /**
+     * @param seed Random seed
+     */
+    constexpr explicit splitmix64(std::uint64_t seed) noexcept
+        : m_state(seed)
+    {
+    }
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    constexpr result_type operator()() noexcept
+    {
+        result_type z = (m_state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+  private:
+    std::uint64_t m_state;
+};
+
+/**
+ * Draw a uniformly distributed integer at compile time
+ * @param rnd Random engine
+ * @param n   Positive number of possible values
+ * @return    Integer in [0, n)
+ */
+constexpr std::uint64_t constexpr_uniform_int(splitmix64& rnd, std::uint64_t n) noexcept
+{
+    // Reject the lowest values that would be drawn once more often than the others
+    std::uint64_t const threshold = (0 - n) % n;
+    std::uint64_t r = rnd();
+    while (r < threshold)
+        r = rnd();
+    return r % n;
+}
+
+/**
+ * Draw a uniformly distributed real number at compile time
+ * @tparam T  Floating point type
+ * @param rnd Random engine
+ * @param a   Lower bound
+ * @param b   Upper bound
+ * @return    Real number in [a, b)
+ */
+template<typename T>
+constexpr T constexpr_uniform_real(splitmix64& rnd, T a, T b) noexcept
+{
+    static_assert(std::is_floating_point_v<T>, "T must be a floating point type");
+
+    // The upper 53 bits fill the mantissa of a double in [0, 1)
+    double const unit = static_cast<double>(rnd() >> 11) / static_cast<double>(1ull << 53);
+    T const result = a + static_cast<T>(unit) * (b - a);
+    return result < b ? result : a;
+}
+
+static_assert(splitmix64{0}() == 0xe220a8397b1dcdaf);
+static_assert([] {
+    splitmix64 rnd{0};
+    return constexpr_uniform_int(rnd, 10) < 10;
+}());
+static_assert([] {
+    splitmix64 rnd{0};
+    auto const r = constexpr_uniform_real(rnd, -1.f, 1.f);
+    return r >= -1.f && r < 1.f;
+}());
+
+} // namespace noise
+
+#endif // PERLINNOISE_RANDOM_H
@@ -9,10 +9,17 @@
 #ifndef PERLINNOISE_SEAMLESS_NOISE_GENERATOR_2D_H
 #define PERLINNOISE_SEAMLESS_NOISE_GENERATOR_2D_H
 
+#include "perlin/generator_traits.h"
+#include "perlin/instrumentation.h"
 #include "perlin/math.h"
 #include "perlin/point.h"
+#include "perlin/vector.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <random>
+#include <vector>
 
 namespace noise
 {
@@ -27,8 +34,13 @@ namespace noise
  * fractal_noise_generator
  * @tparam Width  Width of the noise function until it repeats
  * @tparam Height Height of the noise function until it repeats
+ * @tparam Instrumentation Policy counting samples and grids, e.g. counting_instrumentation. The
+ * default no_instrumentation compiles to nothing.
  */
-template<class Gen, typename Gen::grid_coord_t Width, typename Gen::grid_coord_t Height>
+template<class Gen,
+         typename Gen::grid_coord_t Width,
+         typename Gen::grid_coord_t Height,
+         class Instrumentation = no_instrumentation>
 class seamless_noise_generator_2d
 {
   public:
@@ -58,6 +70,8 @@ class seamless_noise_generator_2d
      */
     result_t at(point<result_t, dimensions> const& p) const noexcept
     {
+        Instrumentation::count(counter::samples);
+
         constexpr result_t const pi = constants<result_t>::pi;
         constexpr result_t const two_pi = 2 * pi;
 
@@ -74,8 +88,158 @@ class seamless_noise_generator_2d
         return m_noiseGen.at(point<result_t, 4>{nx, ny, nz, nw});
     }
 
+    /**
+     * Evaluate the noise function on a regular grid of points.
+     *
+     * @details The grid spans the points origin + i * step for all 0 <= i < extents, where the
+     * index i is taken element-wise. Values are written in row-major order, with the x coordinate
+     * varying fastest.
+     *
+     *          The torus coordinates only depend on either x or y, so they are computed once per
+     * column and once per row. Every row is passed to the underlying generator in one go if it can
+     * evaluate ranges of points at once. The results are identical to calling at() on every point.
+     *
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param origin    First point of the grid
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param extents   Number of grid points along each dimension
+     * @param out       Destination of the prod(extents) noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class OutputIt>
+    OutputIt fill_grid(point<result_t, dimensions> const& origin,
+                       vector<result_t, dimensions> const& step,
+                       point<int, dimensions> const& extents,
+                       OutputIt out) const
+    {
+        return fill_grid(origin, step, point<int, dimensions>{}, extents, out);
+    }
+
+    /**
+     * Evaluate the noise function on a section of a regular grid of points.
+     *
+     * @details Like fill_grid(origin, step, extents, out), but only evaluates the points
+     * origin + i * step for first <= i < first + extents. Splitting a grid into sections yields
+     * exactly the same values as evaluating it at once.
+     *
+     * @tparam OutputIt Output iterator accepting result_t
+     * @param origin    Point of the grid at index 0
+     * @param step      Distance between adjacent grid points along each dimension
+     * @param first     Index of the first grid point of the section
+     * @param extents   Number of grid points of the section along each dimension
+     * @param out       Destination of the prod(extents) noise values
+     * @return          Output iterator one past the last written value
+     */
+    template<class OutputIt>
+    OutputIt fill_grid(point<result_t, dimensions> const& origin,
+                       vector<result_t, dimensions> const& step,
+                       point<int, dimensions> const& first,
+                       point<int, dimensions> const& extents,
+                       OutputIt out) const
+    {
+        if (extents[0] <= 0 || extents[1] <= 0)
+            return out;
+
+        Instrumentation::count(counter::grids);
+        Instrumentation::count(counter::samples,
+                               static_cast<std::uint64_t>(extents[0])
+                                   * static_cast<std::uint64_t>(extents[1]));
+
+        auto const columns = torus_coords<Width>(origin[0], step[0], first[0], extents[0]);
+        auto const rows = torus_coords<Height>(origin[1], step[1], first[1], extents[1]);
+
+        std::vector<point<result_t, 4>> points(extents[0]);
+        for (auto const& row : rows)
+        {
+            std::transform(columns.begin(), columns.end(), points.begin(), [&row](auto const& col) {
+                return point<result_t, 4>{col[0], row[0], col[1], row[1]};
+            });
+
+            if constexpr (has_batch_at_v<Gen>)
+                out = m_noiseGen.at(points.data(), points.data() + points.size(), out);
+            else
+            {
+                out = std::transform(points.begin(), points.end(), out, [this](auto const& p) {
+                    return m_noiseGen.at(p);
+                });
+            }
+        }
+        return out;
+    }
+
+    /**
+     * Evaluate the noise function and its gradient at a given point.
+     *
+     * @details Requires the underlying generator to provide at_with_gradient(). The 4d gradient is
+     * mapped back to 2d by the chain rule through the torus mapping.
+     *
+     * @param p Point of evaluation
+     * @return  Noise function value and its partial derivatives at the specified point
+     */
+    value_and_gradient<result_t, dimensions> at_with_gradient(
+        point<result_t, dimensions> const& p) const noexcept
+    {
+        Instrumentation::count(counter::samples);
+
+        constexpr result_t const pi = constants<result_t>::pi;
+        constexpr result_t const two_pi = 2 * pi;
+
+        auto s = p[0] / static_cast<result_t>(Width);
+        auto t = p[1] / static_cast<result_t>(Height);
+
+        auto multiplier_x = static_cast<result_t>(Width) / two_pi;
+        auto multiplier_y = static_cast<result_t>(Height) / two_pi;
+        auto cos_s = std::cos(s * two_pi);
+        auto cos_t = std::cos(t * two_pi);
+        auto sin_s = std::sin(s * two_pi);
+        auto sin_t = std::sin(t * two_pi);
+
+        auto nx = cos_s * multiplier_x;
+        auto ny = cos_t * multiplier_y;
+        auto nz = sin_s * multiplier_x;
+        auto nw = sin_t * multiplier_y;
+        auto const result = m_noiseGen.at_with_gradient(point<result_t, 4>{nx, ny, nz, nw});
+
+        // d(nx, nz)/dx = (-sin, cos) and d(ny, nw)/dy = (-sin, cos), the multipliers cancel out
+        auto const& g = result.gradient;
+        return {result.value,
+                vector<result_t, dimensions>{-sin_s * g[0] + cos_s * g[2],
+                                             -sin_t * g[1] + cos_t * g[3]}};
+    }
+
   private:
     Gen m_noiseGen;
+
+    /**
+     * Map coordinates along one axis onto a circle
+     *
+     * @tparam Period Period of the axis
+     * @param origin  Coordinate at index 0
+     * @param step    Distance between adjacent coordinates
+     * @param first   Index of the first coordinate
+     * @param count   Number of coordinates
+     * @return        Cosine and sine components of the circle, as used by at()
+     */
+    template<grid_coord_t Period>
+    static std::vector<std::array<result_t, 2>> torus_coords(result_t origin,
+                                                             result_t step,
+                                                             int first,
+                                                             int count)
+    {
+        constexpr result_t const pi = constants<result_t>::pi;
+        constexpr result_t const two_pi = 2 * pi;
+
+        auto multiplier = static_cast<result_t>(Period) / two_pi;
+
+        std::vector<std::array<result_t, 2>> coords(count);
+        for (int i = 0; i < count; ++i)
+        {
+            auto pos = origin + static_cast<result_t>(first + i) * step;
+            auto s = pos / static_cast<result_t>(Period);
+            coords[i] = {std::cos(s * two_pi) * multiplier, std::sin(s * two_pi) * multiplier};
+        }
+        return coords;
+    }
 };
 
 } // namespace noise
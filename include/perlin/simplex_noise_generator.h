@@ -0,0 +1,171 @@
+/**********************************************************
+ * @file   simplex_noise_generator.h
+ * @author jan
+ * @date   7/22/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_SIMPLEX_NOISE_GENERATOR_H
+#define PERLINNOISE_SIMPLEX_NOISE_GENERATOR_H
+
+#include "perlin/gradient_table.h"
+#include "perlin/math.h"
+#include "perlin/point.h"
+#include "perlin/random.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <random>
+
+namespace noise
+{
+/**
+ * Generates simplex noise in arbitrary dimensions.
+ *
+ * @details Simplex noise is a coherent noise similar to perlin noise, but it is defined on a
+ * simplicial grid instead of a hypercubic one. Every point is influenced by the Dim + 1 corners of
+ * the simplex it lies in instead of the 2^Dim corners of a hypercube, so evaluation scales linearly
+ * with the number of dimensions.
+ *
+ *          Noise is generated in the [-1,1] domain. The generator can be used wherever a
+ * perlin_noise_generator can, e.g. within fractal_noise_generator or seamless_noise_generator_2d.
+ *
+ * @tparam Dim          Dimensionality of the noise function
+ * @tparam Result       Floating point result type
+ * @tparam NumGradients Amount of random gradients to use. A larger number results in more
+ * randomness, but longer computation times. Powers of two are considerably faster to evaluate.
+ * @tparam GridCoord    Integral grid coordinate type
+ */
+template<int Dim, typename Result = float, int NumGradients = 256, typename GridCoord = int>
+class simplex_noise_generator
+{
+  public:
+    static_assert(Dim > 0, "Must have at least one dimension");
+    static_assert(std::is_floating_point_v<Result>, "Result must be a floating point type");
+
+    using result_t = Result;
+    using grid_coord_t = GridCoord;
+
+    static constexpr const int dimensions = Dim;
+
+    /**
+     * @param seed Random seed for noise generation
+     */
+    template<class RndEngine = std::default_random_engine>
+    explicit simplex_noise_generator(RndEngine&& rnd) noexcept
+        : m_gradients(std::forward<RndEngine>(rnd))
+    {
+    }
+
+    /**
+     * Construct the generator in a constant expression.
+     *
+     * @details A constexpr generator has its tables baked into read-only data and costs nothing at
+     * startup. The tables differ from the ones generated by a standard engine, but not between
+     * compile time and run time construction.
+     *
+     * @param rnd Random engine for noise generation
+     */
+    constexpr explicit simplex_noise_generator(splitmix64& rnd) noexcept
+        : m_gradients(rnd)
+    {
+    }
+
+    /**
+     * @param rnd Random engine for noise generation
+     */
+    constexpr explicit simplex_noise_generator(splitmix64&& rnd) noexcept
+        : m_gradients(rnd)
+    {
+    }
+
+    /**
+     * Evaluate the noise function at a given point.
+     *
+     * @details Can be evaluated in constant expressions.
+     *
+     * @param p Point of evaluation
+     * @return  Noise function value at the specified point
+     */
+    constexpr result_t at(point<result_t, Dim> const& p) const noexcept
+    {
+        // Skew the input space to find the hypercube containing the point
+        result_t sum = 0;
+        for (int d = 0; d < Dim; ++d)
+            sum += p[d];
+        auto const skew = sum * s_skew;
+        point<grid_coord_t, Dim> baseGridPoint;
+        result_t gridSum = 0;
+        for (int d = 0; d < Dim; ++d)
+        {
+            baseGridPoint[d] = constexpr_floor<grid_coord_t>(p[d] + skew);
+            gridSum += static_cast<result_t>(baseGridPoint[d]);
+        }
+
+        // Vector from the unskewed base grid point to the point
+        auto const unskew = gridSum * s_unskew;
+        vector<result_t, Dim> nodeVec;
+        for (int d = 0; d < Dim; ++d)
+            nodeVec[d] = p[d] - (static_cast<result_t>(baseGridPoint[d]) - unskew);
+
+        // The simplex is found by stepping along the dimensions in order of decreasing offset. The
+        // rank of a dimension is its position in that order.
+        std::array<int, Dim> rank{};
+        for (int d1 = 0; d1 < Dim; ++d1)
+        {
+            for (int d2 = d1 + 1; d2 < Dim; ++d2)
+            {
+                if (nodeVec[d1] >= nodeVec[d2])
+                    rank[d2]++;
+                else
+                    rank[d1]++;
+            }
+        }
+
+        // Sum up the contributions of all simplex corners
+        result_t result = 0;
+        for (int n = 0; n <= Dim; ++n)
+        {
+            point<grid_coord_t, Dim> gridPoint;
+            vector<result_t, Dim> cornerVec;
+            for (int d = 0; d < Dim; ++d)
+            {
+                auto const step = rank[d] < n ? 1 : 0;
+                gridPoint[d] = baseGridPoint[d] + step;
+                cornerVec[d] = nodeVec[d] - step + n * s_unskew;
+            }
+
+            auto const falloff = s_radius - sq_magnitude(cornerVec);
+            if (falloff > 0)
+                result += static_powi<4>(falloff) * dot(m_gradients.at(gridPoint), cornerVec);
+        }
+
+        // Account for rounding errors
+        return std::clamp(result * s_scale, static_cast<result_t>(-1), static_cast<result_t>(1));
+    }
+
+  private:
+    static constexpr const result_t s_skew = (constexpr_sqrt(result_t{Dim + 1}) - 1) / Dim;
+    static constexpr const result_t s_unskew = (1 - 1 / constexpr_sqrt(result_t{Dim + 1})) / Dim;
+
+    // Squared radius of influence of a corner, small enough to stay within adjacent simplices
+    static constexpr const result_t s_radius = 0.5;
+
+    // A single corner contributes the most at distance sqrt(s_radius) / 3 along its gradient. In
+    // low dimensions, multiple corners can add up to slightly more; these factors were determined
+    // numerically.
+    static constexpr const result_t s_peak
+        = static_powi<4>(s_radius * 8 / 9) * constexpr_sqrt(s_radius) / 3;
+    static constexpr const result_t s_amplitude
+        = s_peak * (Dim == 1 ? result_t(1.55) : Dim == 2 ? result_t(1.1) : result_t(1.01));
+
+    // Maps the sum of contributions to [-1,1]
+    static constexpr const result_t s_scale = 1 / s_amplitude;
+
+    gradient_table<Dim, Result, NumGradients, GridCoord> m_gradients;
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_SIMPLEX_NOISE_GENERATOR_H
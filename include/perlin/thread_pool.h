@@ -0,0 +1,259 @@
+/**********************************************************
+ * @file   thread_pool.h
+ * @author jan
+ * @date   7/21/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_THREAD_POOL_H
+#define PERLINNOISE_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace noise
+{
+/**
+ * A work-stealing thread pool for data-parallel loops.
+ *
+ * @details Every worker owns a queue of task indices. A loop is split into contiguous blocks, one
+ * per queue, so that neighboring tasks are likely executed by the same thread. Workers take tasks
+ * from the front of their own queue and, once it runs dry, steal from the back of other queues.
+ *
+ *          The thread calling parallel_for() takes part in the work, so a pool of size 1 does not
+ * spawn any threads at all. Tasks may call parallel_for() on the same pool again, e.g. to render
+ * a map from within a job. The nested loop then runs on the calling thread alone, as all threads
+ * of the pool are already busy with the outer one.
+ */
+class thread_pool
+{
+  public:
+    /**
+     * @param numThreads Number of threads to work on a loop, including the calling thread
+     */
+    explicit thread_pool(unsigned int numThreads = std::thread::hardware_concurrency())
+    {
+        numThreads = std::max(numThreads, 1u);
+        for (unsigned int i = 0; i < numThreads; ++i)
+            m_queues.push_back(std::make_unique<task_queue>());
+        for (unsigned int i = 1; i < numThreads; ++i)
+            m_threads.emplace_back([this, i]() { run_worker(i); });
+    }
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    ~thread_pool() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeup.notify_all();
+        for (auto& t : m_threads)
+            t.join();
+    }
+
+    /**
+     * @return Number of threads working on a loop, including the calling thread
+     */
+    unsigned int size() const noexcept { return static_cast<unsigned int>(m_queues.size()); }
+
+    /**
+     * Call a function for every index in [0, count) and wait until all calls have returned.
+     *
+     * @details If any of the calls throws, the first exception is rethrown after all other tasks
+     * have finished.
+     *
+     * @tparam F    Function type, invocable with a std::size_t
+     * @param count Number of tasks
+     * @param fun   Function to call
+     */
+    template<class F>
+    void parallel_for(std::size_t count, F&& fun)
+    {
+        if (count == 0)
+            return;
+
+        // Waiting for the pool from within one of its own tasks would never return
+        if (working_pool() == this)
+        {
+            run_inline(count, fun);
+            return;
+        }
+
+        std::function<void(std::size_t)> job = std::forward<F>(fun);
+        std::lock_guard<std::mutex> jobLock(m_jobMutex);
+
+        std::size_t const numQueues = m_queues.size();
+        for (std::size_t q = 0; q < numQueues; ++q)
+        {
+            std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+            for (std::size_t i = q * count / numQueues; i < (q + 1) * count / numQueues; ++i)
+                m_queues[q]->tasks.push_back(i);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_busy = m_threads.size();
+            m_exception = nullptr;
+            ++m_generation;
+        }
+        m_wakeup.notify_all();
+
+        work(0, job);
+
+        std::exception_ptr exception;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_busy == 0; });
+            m_job = nullptr;
+            exception = m_exception;
+        }
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+  private:
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<task_queue>> m_queues; // Queue 0 belongs to the calling thread
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_jobMutex; // Serializes concurrent calls to parallel_for()
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_done;
+    std::function<void(std::size_t)> const* m_job = nullptr;
+    std::size_t m_generation = 0;
+    std::size_t m_busy = 0;
+    std::exception_ptr m_exception;
+    bool m_stop = false;
+
+    void run_worker(std::size_t index)
+    {
+        std::size_t generation = 0;
+        while (true)
+        {
+            std::function<void(std::size_t)> const* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeup.wait(lock, [&]() { return m_stop || m_generation != generation; });
+                if (m_stop)
+                    return;
+                generation = m_generation;
+                job = m_job;
+            }
+
+            work(index, *job);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_busy == 0)
+                    m_done.notify_one();
+            }
+        }
+    }
+
+    /**
+     * @return Pool whose job the current thread is working on, if any
+     */
+    static thread_pool const*& working_pool() noexcept
+    {
+        thread_local thread_pool const* pool = nullptr;
+        return pool;
+    }
+
+    /**
+     * Run a nested loop on the current thread, with the same exception semantics as parallel_for()
+     */
+    template<class F>
+    static void run_inline(std::size_t count, F& fun)
+    {
+        std::exception_ptr exception;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            try
+            {
+                fun(i);
+            }
+            catch (...)
+            {
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    void work(std::size_t index, std::function<void(std::size_t)> const& job)
+    {
+        // Restores the previous pool, as the calling thread may work on nested pools
+        struct working_scope
+        {
+            thread_pool const* previous;
+            ~working_scope() { working_pool() = previous; }
+        } const scope{std::exchange(working_pool(), this)};
+
+        std::size_t task = 0;
+        while (pop(index, task) || steal(index, task))
+        {
+            try
+            {
+                job(task);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_exception)
+                    m_exception = std::current_exception();
+            }
+        }
+    }
+
+    bool pop(std::size_t index, std::size_t& task)
+    {
+        auto& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(std::size_t index, std::size_t& task)
+    {
+        for (std::size_t i = 1; i < m_queues.size(); ++i)
+        {
+            auto& queue = *m_queues[(index + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_THREAD_POOL_H
@@ -0,0 +1,314 @@
+/**********************************************************
+ * @file   tile_cache.h
+ * @author jan
+ * @date   7/26/18
+ * ********************************************************
+ * @brief
+ * @details
+ **********************************************************/
+#ifndef PERLINNOISE_TILE_CACHE_H
+#define PERLINNOISE_TILE_CACHE_H
+
+#include "perlin/generator_traits.h"
+#include "perlin/point.h"
+#include "perlin/vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace noise
+{
+/**
+ * Thread-safe cache of rendered 2d noise map tiles with least-recently-used eviction.
+ *
+ * @details Tiles are squares of TileSize pixels. The pixel (x, y) of the tile t at level of
+ * detail lod is evaluated at origin + (t * TileSize + (x, y)) * step * 2^lod, so a tile covers
+ * the area of four tiles of the next finer level.
+ *
+ *          Generators providing at(p, footprint, tolerance), like fractal_noise_generator, are
+ * given the pixel spacing of the level as footprint, so coarse tiles omit the octaves that would
+ * alias instead of just sampling further apart. Other generators are sampled directly, and their
+ * tiles at level 0 are identical to the corresponding sections rendered by
+ * render_noise_map_section().
+ *
+ *          A cache is bound to the generator it renders with. Tiles are identified by their
+ * coordinates and their level of detail. If the tiles exceed the memory budget, the least recently
+ * used ones are evicted. Tiles handed out before remain valid, since they are shared.
+ *
+ *          Concurrent requests for a tile that is still being rendered wait for that rendering
+ * instead of starting their own.
+ *
+ * @tparam Gen      Two-dimensional noise generator
+ * @tparam TileSize Edge length of a tile in pixels
+ */
+template<class Gen, int TileSize = 64>
+class tile_cache
+{
+  public:
+    static_assert(Gen::dimensions == 2, "Tiles can only be rendered from 2D generators");
+    static_assert(TileSize > 0, "Tiles must not be empty");
+
+    using result_t = typename Gen::result_t;
+    using tile_t = std::vector<result_t>;
+    using tile_ptr = std::shared_ptr<tile_t const>;
+
+    static constexpr const int tile_size = TileSize;
+    static constexpr const std::size_t tile_bytes = sizeof(result_t) * TileSize * TileSize;
+
+    /**
+     * @param gen          Noise generator to render the tiles with, which must outlive the cache
+     * @param origin       Point corresponding to the pixel at (0, 0)
+     * @param step         Distance between adjacent pixels at level of detail 0
+     * @param memoryBudget Maximum size of all cached tiles in bytes
+     * @param tolerance    Weight of octaves that may be dropped, see fractal_noise_generator
+     */
+    tile_cache(Gen const& gen,
+               point2d<result_t> const& origin,
+               vec2d<result_t> const& step,
+               std::size_t memoryBudget,
+               result_t tolerance = 0)
+        : m_gen(gen)
+        , m_origin(origin)
+        , m_step(step)
+        , m_tolerance(tolerance)
+        , m_capacity(memoryBudget / tile_bytes)
+    {
+    }
+
+    tile_cache(tile_cache const&) = delete;
+    tile_cache& operator=(tile_cache const&) = delete;
+
+    /**
+     * Get a tile, rendering it if it isn't cached yet.
+     *
+     * @param tile Tile coordinates
+     * @param lod  Non-negative level of detail
+     * @return     Row-major values of the tile
+     */
+    tile_ptr get(point2d_i const& tile, int lod = 0)
+    {
+        tile_key const key{tile[0], tile[1], lod};
+
+        std::promise<tile_ptr> promise;
+        std::shared_future<tile_ptr> cached;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_index.find(key);
+            if (iter != m_index.end())
+            {
+                ++m_hits;
+                m_entries.splice(m_entries.begin(), m_entries, iter->second);
+                cached = iter->second->tile;
+            }
+            else
+            {
+                ++m_misses;
+                m_entries.push_front({key, promise.get_future().share(), false});
+                m_index.emplace(key, m_entries.begin());
+            }
+        }
+
+        // Wait for the tile outside of the lock, as it may still be rendered by another thread
+        if (cached.valid())
+            return cached.get();
+
+        tile_ptr result;
+        try
+        {
+            result = render(tile, lod);
+        }
+        catch (...)
+        {
+            // Let later requests try again
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                remove(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        promise.set_value(result);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto iter = m_index.find(key);
+        if (iter != m_index.end())
+        {
+            iter->second->ready = true;
+            ++m_size;
+            evict();
+        }
+        return result;
+    }
+
+    /**
+     * @return Number of requests served from the cache, including requests that waited for a
+     * tile being rendered by another thread
+     */
+    std::size_t hits() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hits;
+    }
+
+    /**
+     * @return Number of requests that rendered a tile
+     */
+    std::size_t misses() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_misses;
+    }
+
+    /**
+     * @return Number of tiles evicted to stay within the memory budget
+     */
+    std::size_t evictions() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_evictions;
+    }
+
+    /**
+     * @return Size of all cached tiles in bytes
+     */
+    std::size_t memory_usage() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size * tile_bytes;
+    }
+
+    /**
+     * Remove all rendered tiles. Tiles being rendered are kept.
+     */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto iter = m_entries.begin(); iter != m_entries.end();)
+        {
+            auto const current = iter++;
+            if (current->ready)
+            {
+                m_index.erase(current->key);
+                m_entries.erase(current);
+                --m_size;
+            }
+        }
+    }
+
+  private:
+    struct tile_key
+    {
+        int x;
+        int y;
+        int lod;
+
+        bool operator==(tile_key const& other) const noexcept
+        {
+            return x == other.x && y == other.y && lod == other.lod;
+        }
+    };
+
+    struct tile_key_hash
+    {
+        std::size_t operator()(tile_key const& key) const noexcept
+        {
+            std::size_t hash = 0;
+            for (int v : {key.x, key.y, key.lod})
+                hash = hash * 31 + std::hash<int>{}(v);
+            return hash;
+        }
+    };
+
+    struct entry
+    {
+        tile_key key;
+        std::shared_future<tile_ptr> tile;
+        bool ready; // Tiles being rendered can't be evicted and don't count towards the budget
+    };
+
+    Gen const& m_gen;
+    point2d<result_t> m_origin;
+    vec2d<result_t> m_step;
+    result_t m_tolerance;
+    std::size_t m_capacity; // Maximum number of rendered tiles
+
+    mutable std::mutex m_mutex;
+    std::list<entry> m_entries; // Most recently used first
+    std::unordered_map<tile_key, typename std::list<entry>::iterator, tile_key_hash> m_index;
+    std::size_t m_size = 0; // Number of rendered tiles
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+    std::size_t m_evictions = 0;
+
+    tile_ptr render(point2d_i const& tile, int lod) const
+    {
+        vec2d<result_t> step;
+        for (int d = 0; d < 2; ++d)
+            step[d] = std::ldexp(m_step[d], lod);
+        point2d_i const first{tile[0] * TileSize, tile[1] * TileSize};
+
+        auto values = std::make_shared<tile_t>(TileSize * TileSize);
+        if constexpr (has_fill_grid_v<Gen> && !has_footprint_at_v<Gen>)
+        {
+            m_gen.fill_grid(m_origin, step, first, point2d_i{TileSize, TileSize}, values->data());
+        }
+        else
+        {
+            auto const footprint = std::max(std::abs(step[0]), std::abs(step[1]));
+            auto out = values->begin();
+            for (int y = 0; y < TileSize; ++y)
+            {
+                auto const yPos = m_origin[1] + static_cast<result_t>(first[1] + y) * step[1];
+                for (int x = 0; x < TileSize; ++x)
+                {
+                    auto const xPos = m_origin[0] + static_cast<result_t>(first[0] + x) * step[0];
+                    point2d<result_t> const p{xPos, yPos};
+                    if constexpr (has_footprint_at_v<Gen>)
+                        *out++ = m_gen.at(p, footprint, m_tolerance);
+                    else
+                        *out++ = m_gen.at(p);
+                }
+            }
+        }
+        return values;
+    }
+
+    void remove(tile_key const& key)
+    {
+        auto iter = m_index.find(key);
+        if (iter == m_index.end())
+            return;
+        if (iter->second->ready)
+            --m_size;
+        m_entries.erase(iter->second);
+        m_index.erase(iter);
+    }
+
+    void evict()
+    {
+        for (auto iter = m_entries.end(); m_size > m_capacity && iter != m_entries.begin();)
+        {
+            auto const current = --iter;
+            if (current->ready)
+            {
+                iter = std::next(current);
+                m_index.erase(current->key);
+                m_entries.erase(current);
+                --m_size;
+                ++m_evictions;
+            }
+        }
+    }
+};
+
+} // namespace noise
+
+#endif // PERLINNOISE_TILE_CACHE_H
@@ -154,17 +154,23 @@ class vector : private point<T, Dim>
     }
 };
 
+// Plain loops instead of std::inner_product and std::accumulate, which aren't constexpr in C++17
 template<typename T, int Dim>
 constexpr T dot(vector<T, Dim> const& v1, vector<T, Dim> const& v2) noexcept
 {
-    return std::inner_product(v1.begin(), v1.end(), v2.begin(), T{0});
+    T result{0};
+    for (int i = 0; i < Dim; ++i)
+        result = result + v1[i] * v2[i];
+    return result;
 }
 
 template<typename T, int Dim>
 constexpr T sq_magnitude(vector<T, Dim> const& v) noexcept
 {
-    return std::accumulate(
-        v.begin(), v.end(), T{0}, [](T const& e1, T const e2) { return e1 + (e2 * e2); });
+    T result{0};
+    for (int i = 0; i < Dim; ++i)
+        result = result + (v[i] * v[i]);
+    return result;
 }
 
 template<typename T, int Dim>
@@ -194,6 +200,18 @@ constexpr std::ostream& operator<<(std::ostream& os, vector<T, Dim> const& v) no
     return os;
 }
 
+/**
+ * Value of a function together with its gradient
+ * @tparam T   Floating point type
+ * @tparam Dim Dimensionality of the function's domain
+ */
+template<typename T, int Dim>
+struct value_and_gradient
+{
+    T value;
+    vector<T, Dim> gradient;
+};
+
 template<typename T>
 using vec2d = vector<T, 2>;
 using vec2d_f = vec2d<float>;
@@ -1,4 +1,6 @@
+#include "perlin/colormap.h"
 #include "perlin/fractal_noise_generator.h"
+#include "perlin/noise_map_renderer.h"
 #include "perlin/perlin_noise_generator.h"
 #include "perlin/point.h"
 #include "perlin/seamless_noise_generator_2d.h"
@@ -6,9 +8,13 @@
 
 #include <png.h>
 
+#include <array>
 #include <chrono>
+#include <cstdio>
+#include <future>
 #include <iostream>
-#include <map>
+#include <string>
+#include <vector>
 
 /*
  * NOTE: Most of this is just boilerplate code to write pngs to disk. Look at
@@ -18,272 +24,213 @@
 
 using namespace noise;
 
-template<typename Gen>
-struct noisemap
+/**
+ * Writes a png image row by row, so that the image never needs to be held in memory as a whole.
+ */
+class png_writer
 {
-    int m_width;
-    int m_height;
-    std::vector<typename Gen::result_t> m_values;
-
-    noisemap(int width, int height)
-        : m_width(width)
-        , m_height(height)
+  public:
+    png_writer(std::string const& filename, int width, int height, int colorType)
     {
-        m_values.resize(width * height);
-    }
+        char const* title = filename.c_str();
 
-    noisemap() = default;
-};
+        // Open file for writing (binary mode)
+        m_fp = fopen(filename.c_str(), "wb");
+        if (m_fp == nullptr)
+        {
+            fprintf(stderr, "Could not open file %s for writing\n", filename.c_str());
+            return;
+        }
 
-template<class Gen>
-noisemap<Gen> generate_noise_map(
-    Gen& gen,
-    int width,
-    int height,
-    int cellsX,
-    int cellsY,
-    std::function<point<typename Gen::result_t, Gen::dimensions>(typename Gen::result_t,
-                                                                 typename Gen::result_t)> mapPoint)
-{
-    noisemap<Gen> result{width, height};
+        // Initialize write structure
+        m_png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        if (m_png == nullptr)
+        {
+            fprintf(stderr, "Could not allocate write struct\n");
+            return;
+        }
 
-    for (int y = 0; y < height; y++)
-    {
-        for (int x = 0; x < width; x++)
+        // Initialize info structure
+        m_info = png_create_info_struct(m_png);
+        if (m_info == nullptr)
         {
-            float xPos = (float)x / (width / (float)cellsX);
-            float yPos = (float)y / (height / (float)cellsY);
-            auto val = std::clamp(gen.at(mapPoint(xPos, yPos)), -1.f, 1.f);
-            result.m_values[x + width * y] = val;
+            fprintf(stderr, "Could not allocate info struct\n");
+            return;
         }
-    }
 
-    return result;
-}
+        // Setup Exception handling
+        if (setjmp(png_jmpbuf(m_png)))
+        {
+            fprintf(stderr, "Error during png creation\n");
+            return;
+        }
 
-template<class Gen>
-int generate_png(noisemap<Gen> const& map, std::string const& filename)
-{
-    char const* title = filename.c_str();
-    FILE* fp = nullptr;
-    png_structp png_ptr = nullptr;
-    png_infop info_ptr = nullptr;
-
-    auto finalize = [&]() {
-        if (fp != nullptr)
-            fclose(fp);
-        if (info_ptr != nullptr)
-            png_free_data(png_ptr, info_ptr, PNG_FREE_ALL, -1);
-        if (png_ptr != nullptr)
-            png_destroy_write_struct(&png_ptr, (png_infopp) nullptr);
-    };
+        png_init_io(m_png, m_fp);
 
-    // Open file for writing (binary mode)
-    fp = fopen(filename.c_str(), "wb");
-    if (fp == nullptr)
-    {
-        fprintf(stderr, "Could not open file %s for writing\n", filename.c_str());
-        finalize();
-        return 1;
-    }
+        // Write header (8 bit depth)
+        png_set_IHDR(m_png,
+                     m_info,
+                     width,
+                     height,
+                     8,
+                     colorType,
+                     PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_BASE,
+                     PNG_FILTER_TYPE_BASE);
 
-    // Initialize write structure
-    png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (png_ptr == nullptr)
-    {
-        fprintf(stderr, "Could not allocate write struct\n");
-        finalize();
-        return 1;
-    }
+        // Set title
+        png_text title_text;
+        title_text.compression = PNG_TEXT_COMPRESSION_NONE;
+        title_text.key = const_cast<char*>("Title");
+        title_text.text = const_cast<char*>(title);
+        png_set_text(m_png, m_info, &title_text, 1);
 
-    // Initialize info structure
-    info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == nullptr)
-    {
-        fprintf(stderr, "Could not allocate info struct\n");
-        finalize();
-        return 1;
+        png_write_info(m_png, m_info);
+        m_ok = true;
     }
 
-    // Setup Exception handling
-    if (setjmp(png_jmpbuf(png_ptr)))
+    png_writer(png_writer const&) = delete;
+    png_writer& operator=(png_writer const&) = delete;
+
+    ~png_writer()
     {
-        fprintf(stderr, "Error during png creation\n");
-        finalize();
-        return 1;
+        if (m_fp != nullptr)
+            fclose(m_fp);
+        if (m_info != nullptr)
+            png_free_data(m_png, m_info, PNG_FREE_ALL, -1);
+        if (m_png != nullptr)
+            png_destroy_write_struct(&m_png, (png_infopp) nullptr);
     }
 
-    png_init_io(png_ptr, fp);
-
-    // Write header (8 bit grayscale depth)
-    png_set_IHDR(png_ptr,
-                 info_ptr,
-                 map.m_width,
-                 map.m_height,
-                 8,
-                 PNG_COLOR_TYPE_GRAY,
-                 PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE,
-                 PNG_FILTER_TYPE_BASE);
-
-    // Set title
-    if (title != nullptr)
+    bool ok() const noexcept { return m_ok; }
+
+    bool write_row(png_byte const* row)
     {
-        png_text title_text;
-        title_text.compression = PNG_TEXT_COMPRESSION_NONE;
-        title_text.key = const_cast<char*>("Title");
-        title_text.text = const_cast<char*>(title);
-        png_set_text(png_ptr, info_ptr, &title_text, 1);
-    }
+        if (!m_ok)
+            return false;
 
-    png_write_info(png_ptr, info_ptr);
+        if (setjmp(png_jmpbuf(m_png)))
+        {
+            fprintf(stderr, "Error during png creation\n");
+            return m_ok = false;
+        }
 
-    // Allocate memory for one row (1 bytes per pixel - Grayscale)
-    std::vector<png_byte> row;
-    row.resize(map.m_width);
+        png_write_row(m_png, row);
+        return true;
+    }
 
-    // Write image data
-    for (int y = 0; y < map.m_height; y++)
+    bool finish()
     {
-        for (int x = 0; x < map.m_width; x++)
-        {
-            auto val = map.m_values[x + map.m_width * y];
-            row[x] = png_byte((val + 1) / 2.f * 255);
+        if (!m_ok)
+            return false;
 
-            // Mark grid corners
-            //            if (((std::ceil(xPos) - xPos) < 0.000001f) && ((std::ceil(yPos) - yPos) <
-            //            0.000001f))
-            //                row[x] = 255;
+        if (setjmp(png_jmpbuf(m_png)))
+        {
+            fprintf(stderr, "Error during png creation\n");
+            return m_ok = false;
         }
-        png_write_row(png_ptr, row.data());
-    }
 
-    // End write
-    png_write_end(png_ptr, nullptr);
-    finalize();
+        // End write
+        png_write_end(m_png, nullptr);
+        return true;
+    }
 
-    return 0;
-}
+  private:
+    FILE* m_fp = nullptr;
+    png_structp m_png = nullptr;
+    png_infop m_info = nullptr;
+    bool m_ok = false;
+};
 
-template<class Gen>
-int generate_world_png(noisemap<Gen> const& map, std::string const& filename)
+/**
+ * Convert a row of noise values to grayscale (1 byte per pixel)
+ */
+template<typename T>
+void to_grayscale(T const* values, std::vector<png_byte>& row)
 {
-    char const* title = filename.c_str();
-    FILE* fp = nullptr;
-    png_structp png_ptr = nullptr;
-    png_infop info_ptr = nullptr;
-
-    auto finalize = [&]() {
-        if (fp != nullptr)
-            fclose(fp);
-        if (info_ptr != nullptr)
-            png_free_data(png_ptr, info_ptr, PNG_FREE_ALL, -1);
-        if (png_ptr != nullptr)
-            png_destroy_write_struct(&png_ptr, (png_infopp) nullptr);
-    };
-
-    // Open file for writing (binary mode)
-    fp = fopen(filename.c_str(), "wb");
-    if (fp == nullptr)
+    for (std::size_t x = 0; x < row.size(); x++)
     {
-        fprintf(stderr, "Could not open file %s for writing\n", filename.c_str());
-        finalize();
-        return 1;
+        auto val = values[x];
+        row[x] = png_byte((val + 1) / 2.f * 255);
     }
+}
 
-    // Initialize write structure
-    png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (png_ptr == nullptr)
-    {
-        fprintf(stderr, "Could not allocate write struct\n");
-        finalize();
-        return 1;
-    }
+using Color = std::array<png_byte, 3>;
+static_assert(sizeof(Color) == 3, "Rows of colors must be contiguous bytes");
 
-    // Initialize info structure
-    info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == nullptr)
-    {
-        fprintf(stderr, "Could not allocate info struct\n");
-        finalize();
-        return 1;
-    }
+/**
+ * Colormap for world maps (3 bytes per pixel - RGB)
+ */
+template<typename T>
+colormap<Color, T> const& world_colors()
+{
+    static colormap<Color, T> const colors{{
+        {T(0.55), {255, 255, 255}}, // snow
+        {T(0.4), {150, 150, 160}},  // mountains
+        {T(0.3), {60, 130, 30}},    // forest
+        {T(0.25), {120, 190, 90}},  // grass
+        {T(0.2), {229, 221, 0}},    // shore
+        {T(0.15), {80, 80, 255}},   // shallow water
+        {T(-1), {0, 0, 255}},       // ocean
+    }};
+    return colors;
+}
 
-    // Setup Exception handling
-    if (setjmp(png_jmpbuf(png_ptr)))
-    {
-        fprintf(stderr, "Error during png creation\n");
-        finalize();
-        return 1;
-    }
+/**
+ * Generate a noise map and write it as grayscale and as world map png.
+ *
+ * The map is generated in bands of rows. While one band is written to both images, the next one
+ * is already being generated, so memory use is bounded by two bands regardless of the map size.
+ */
+template<class Gen>
+int generate_pngs(
+    Gen const& gen, int width, int height, int cellsX, int cellsY, std::string const& name)
+{
+    using result_t = typename Gen::result_t;
 
-    png_init_io(png_ptr, fp);
-
-    // Write header (8 bit rgb depth)
-    png_set_IHDR(png_ptr,
-                 info_ptr,
-                 map.m_width,
-                 map.m_height,
-                 8,
-                 PNG_COLOR_TYPE_RGB,
-                 PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE,
-                 PNG_FILTER_TYPE_BASE);
-
-    // Set title
-    if (title != nullptr)
-    {
-        png_text title_text;
-        title_text.compression = PNG_TEXT_COMPRESSION_NONE;
-        title_text.key = const_cast<char*>("Title");
-        title_text.text = const_cast<char*>(title);
-        png_set_text(png_ptr, info_ptr, &title_text, 1);
-    }
+    constexpr int const bandHeight = 64;
+
+    png_writer grayscale{name + "_seamless.png", width, height, PNG_COLOR_TYPE_GRAY};
+    png_writer world{name + "_world.png", width, height, PNG_COLOR_TYPE_RGB};
+    if (!grayscale.ok() || !world.ok())
+        return 1;
 
-    png_write_info(png_ptr, info_ptr);
-
-    // Allocate memory for one row (3 bytes per pixel - RGB)
-    std::vector<png_byte> row;
-    row.resize(map.m_width * 3);
-
-    // Color scale
-    using Color = std::array<png_byte, 3>;
-    std::map<float, Color> colors{
-        {0.55f, {255, 255, 255}}, // snow
-        {0.4f, {150, 150, 160}},  // mountains
-        {0.3f, {60, 130, 30}},    // forest
-        {0.25f, {120, 190, 90}},  // grass
-        {0.2f, {229, 221, 0}},    // shore
-        {0.15f, {80, 80, 255}},   // shallow water
-        {-1.f, {0, 0, 255}},      // ocean
+    thread_pool pool;
+    auto generate_band = [&](int y0) {
+        int const rows = std::min(bandHeight, height - y0);
+        std::vector<result_t> band(static_cast<std::size_t>(width) * rows);
+        render_noise_map_section(pool,
+                                 gen,
+                                 point2d<result_t>{result_t{0}, result_t{0}},
+                                 vec2d<result_t>{cellsX / static_cast<result_t>(width),
+                                                 cellsY / static_cast<result_t>(height)},
+                                 point2d_i{0, y0},
+                                 point2d_i{width, rows},
+                                 band.begin());
+        return band;
     };
 
-    // Write image data
-    for (int y = 0; y < map.m_height; y++)
+    std::vector<png_byte> grayscaleRow(width);
+    std::vector<Color> worldRow(width);
+    auto next = std::async(std::launch::async, generate_band, 0);
+    for (int y0 = 0; y0 < height; y0 += bandHeight)
     {
-        for (int x = 0; x < map.m_width; x++)
+        auto band = next.get();
+        if (y0 + bandHeight < height)
+            next = std::async(std::launch::async, generate_band, y0 + bandHeight);
+
+        for (std::size_t offset = 0; offset < band.size(); offset += width)
         {
-            auto val = map.m_values[x + map.m_width * y];
-            auto colorIter = colors.lower_bound(val);
-            if (colorIter == colors.begin())
-            {
-                std::cerr << "No color for " << val << std::endl;
-                continue;
-            }
-            --colorIter;
-            auto color = colorIter->second;
-            row[(x * 3) + 0] = color[0];
-            row[(x * 3) + 1] = color[1];
-            row[(x * 3) + 2] = color[2];
+            to_grayscale(band.data() + offset, grayscaleRow);
+            world_colors<result_t>().apply(
+                band.begin() + offset, band.begin() + offset + width, worldRow.begin());
+            if (!grayscale.write_row(grayscaleRow.data())
+                || !world.write_row(worldRow.front().data()))
+                return 1;
         }
-        png_write_row(png_ptr, row.data());
     }
 
-    // End write
-    png_write_end(png_ptr, nullptr);
-    finalize();
-
-    return 0;
+    return grayscale.finish() && world.finish() ? 0 : 1;
 }
 
 int main()
@@ -302,22 +249,16 @@ int main()
                                                 exponential_decay<float>,
                                                 exponential_growth<float>>;
     using seamless_gen = seamless_noise_generator_2d<fractal_gen, cellsX, cellsY>;
-    noisemap<seamless_gen> map;
 
     auto start = std::chrono::steady_clock::now();
 
     seamless_gen gen{std::mt19937{seed}};
-    map = generate_noise_map(gen, width, height, cellsX, cellsY, [](float x, float y) {
-        return point2d_f{x, y};
-    });
+    int result = generate_pngs(gen, width, height, cellsX, cellsY, std::to_string(seed));
 
     auto end = std::chrono::steady_clock::now();
-    std::cout << "Generating the noise map took "
+    std::cout << "Generating the noise maps took "
               << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms"
               << std::endl;
 
-    generate_png(map, std::to_string(seed) + "_seamless.png");
-    generate_world_png(map, std::to_string(seed) + "_world.png");
-
-    return 0;
-}
\ No newline at end of file
+    return result;
+}